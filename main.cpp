@@ -1,601 +1,4585 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <random>
+#include <sstream>
 #include <stack>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
+#include <variant>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef GRAPH_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef GRAPH_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 using namespace std;
 
-// Перевод списка смежности в матрицу смежности.
-[[maybe_unused]] vector<vector<int>> FromAdjacencyListToAdjacencyMatrix(size_t count_of_vertexes,
-                                                                        vector<vector<int>> &adjacency_list) {
-  vector<vector<int>> adjacency_matrix(count_of_vertexes, vector<int>(count_of_vertexes, 0));
-  for (size_t i = 0; i < count_of_vertexes; ++i) {
-    for (auto vertex : adjacency_list[i]) {
-      adjacency_matrix[i][vertex] = 1;
-    }
-  }
-  return adjacency_matrix;
+// Дуга графа: пара номеров вершин (нумерация с 0).
+using Arc = pair<size_t, size_t>;
+
+// Вес дуги. В невзвешенном графе вес каждой дуги равен 1.
+using Weight = int64_t;
+
+// Расстояние до недостижимой вершины.
+const Weight kInfinity = numeric_limits<Weight>::max();
+
+// Минимальная часть диапазона, которую имеет смысл отдавать отдельному потоку.
+const size_t kMinParallelGrain = 1024;
+
+// Во сколько раз частей диапазона делается больше, чем потоков, чтобы освободившимся потокам было что украсть.
+const size_t kPartsPerThread = 8;
+
+// Переменная окружения, задающая количество потоков для параллельных алгоритмов.
+const char *const kThreadsVariable = "GRAPH_THREADS";
+
+// Количество потоков для параллельных алгоритмов: значение переменной GRAPH_THREADS или число ядер.
+size_t CountOfThreads() {
+  static const size_t count_of_threads = []() {
+    size_t count = 0;
+    const char *value = getenv(kThreadsVariable);
+    if (value != nullptr)
+      from_chars(value, value + strlen(value), count);
+    if (count == 0)
+      count = thread::hardware_concurrency();
+    return max<size_t>(1, count);
+  }();
+  return count_of_threads;
 }
 
-// Перевод списка ребер в матрицу смежности.
-vector<vector<int>> FromEdgesListToAdjacencyMatrix(size_t count_of_vertexes,
-                                                   vector<pair<int, int>> &list_of_edges,
-                                                   bool is_orient) {
-  vector<vector<int>> adjacency_matrix(count_of_vertexes, vector<int>(count_of_vertexes, 0));
-  for (auto edge : list_of_edges) {
-    adjacency_matrix[edge.first - 1][edge.second - 1] = 1;
-    if (!is_orient) {
-      adjacency_matrix[edge.second - 1][edge.first - 1] = 1;
-    }
-  }
-  return adjacency_matrix;
+// Переменная окружения, при которой выведенные файлы перед закрытием сбрасываются на диск (fsync).
+const char *const kFsyncVariable = "GRAPH_FSYNC";
+
+// Возвращает true, если задана переменная GRAPH_FSYNC со значением, отличным от 0.
+bool IsFsyncRequested() {
+  const char *value = getenv(kFsyncVariable);
+  return value != nullptr && value[0] != '\0' && value[0] != '0';
 }
 
-// Перевод матрицы инцидентности в матрицу смежности.
-vector<vector<int>> FromIncidenceMatrixToAdjacencyMatrix(size_t count_of_vertexes,
-                                                         size_t count_of_edges,
-                                                         vector<vector<int>> incidence_matrix,
-                                                         bool is_orient) {
-  vector<vector<int>> adjacency_matrix(count_of_vertexes, vector<int>(count_of_vertexes, 0));
-  for (size_t i = 0; i < count_of_edges; ++i) {
-    vector<int> edge;
-    int from = -2;
-    int to = -2;
-    for (size_t j = 0; j < count_of_vertexes; ++j) {
-      if (incidence_matrix[j][i] == 0)
-        continue;
-      if (is_orient) {
-        if (incidence_matrix[j][i] == 1)
-          to = static_cast<int>(j);
-        else
-          from = static_cast<int>(j);
-      } else {
-        if (from == -2)
-          from = static_cast<int>(j);
-        else
-          to = static_cast<int>(j);
-      }
+// Переменная окружения, при которой загружаемые графы сразу хранятся в сжатом виде.
+const char *const kCompressVariable = "GRAPH_COMPRESS";
+
+// Возвращает true, если задана переменная GRAPH_COMPRESS со значением, отличным от 0.
+bool IsCompressionRequested() {
+  const char *value = getenv(kCompressVariable);
+  return value != nullptr && value[0] != '\0' && value[0] != '0';
+}
+
+// Общий для всех алгоритмов пул из CountOfThreads() - 1 потоков; еще одним считается вызывающий поток.
+// У каждого потока своя очередь задач: новые задачи кладутся в ее конец и берутся оттуда же,
+// а поток без работы крадет задачи из начала чужих очередей. Поток, ожидающий свои задачи,
+// тем временем выполняет любые другие, поэтому вложенные параллельные циклы не создают новых потоков.
+class ThreadPool {
+ public:
+  // Счетчик невыполненных задач одного параллельного цикла.
+  using Counter = atomic<size_t>;
+
+  // Возвращает общий пул, создавая его при первом обращении.
+  static ThreadPool &Instance() {
+    static ThreadPool pool(CountOfThreads());
+    return pool;
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      lock_guard<mutex> lock(sleep_mutex_);
+      is_stopped_ = true;
     }
-    if (from != -2 && to != -2) {
-      adjacency_matrix[from][to] = 1;
-      if (!is_orient)
-        adjacency_matrix[to][from] = 1;
+    wake_up_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
     }
   }
-  return adjacency_matrix;
-}
 
-// Класс, реализующий работу с графами.
-class Graph {
- private:
-  // Количество ввершин
-  size_t count_of_vertexes_;
-  size_t count_of_edges_;
-  bool is_orient_;
-  string output_path_;
-  string input_path_;
-  vector<vector<int>> adjacency_matrix_;
-
-  // Перевод матрицы смежности в матрицу инцидентности.
-  vector<vector<int>> GetIncidenceMatrix(size_t count_of_vertexes,
-                                         size_t count_of_edges,
-                                         const vector<vector<int>> &adjacency_matrix,
-                                         bool is_orient) {
-    vector<vector<int>> incidence_matrix(count_of_vertexes, vector<int>(count_of_edges, 0));
-    vector<pair<int, int>> list_of_edges = GetListOfEdges(count_of_vertexes, adjacency_matrix, is_orient);
-    for (size_t i = 0; i < list_of_edges.size(); ++i) {
-      int vertex_from = list_of_edges[i].first - 1;
-      int vertex_to = list_of_edges[i].second - 1;
-      incidence_matrix[vertex_from][i] = is_orient ? -1 : 1;
-      incidence_matrix[vertex_to][i] = 1;
+  // Кладет задачу в очередь текущего потока. Счетчик pending уменьшится, когда задача выполнится.
+  void Submit(function<void()> task, Counter &pending) {
+    pending.fetch_add(1, memory_order_relaxed);
+    count_of_queued_.fetch_add(1);
+    TaskQueue &queue = *queues_[QueueIndex()];
+    {
+      lock_guard<mutex> lock(queue.tasks_mutex);
+      queue.tasks.emplace_back([task = move(task), &pending]() {
+        task();
+        pending.fetch_sub(1, memory_order_release);
+      });
+    }
+    if (count_of_sleeping_.load() != 0) {
+      lock_guard<mutex> lock(sleep_mutex_);
+      wake_up_.notify_one();
     }
-    return incidence_matrix;
   }
 
-  // Перевод матрицы смежности в список ребер.
-  vector<vector<int>> GetAdjacencyList(size_t count_of_vertexes, vector<vector<int>> adjacency_matrix) {
-    vector<vector<int>> adjacency_list(count_of_vertexes);
-    for (size_t i = 0; i < count_of_vertexes; ++i) {
-      for (size_t j = 0; j < count_of_vertexes; ++j) {
-        if (adjacency_matrix[i][j]) {
-          adjacency_list[i].push_back(static_cast<int>(j));
-        }
-      }
+  // Выполняет задачи из очередей, пока не выполнятся все задачи счетчика pending.
+  void Wait(Counter &pending) {
+    while (pending.load(memory_order_acquire) != 0) {
+      if (!RunTask())
+        this_thread::yield();
     }
-    return adjacency_list;
   }
 
-  // Перевод матрицы смежности в список ребер.
-  vector<pair<int, int>> GetListOfEdges(size_t count_of_vertexes,
-                                        vector<vector<int>> adjacency_matrix,
-                                        bool is_orient) {
-    vector<pair<int, int>> list_of_edges;
-    for (size_t i = 0; i < count_of_vertexes; ++i) {
-      for (size_t j = 0; j < count_of_vertexes; ++j) {
-        if (!is_orient && i >= j)
-          continue;
-        if (adjacency_matrix[i][j]) {
-          list_of_edges.emplace_back(i + 1, j + 1);
-        }
-      }
+ private:
+  // Очередь задач одного потока.
+  struct TaskQueue {
+    mutex tasks_mutex;
+    deque<function<void()>> tasks;
+  };
+
+  // Очереди потоков пула; последняя очередь общая для потоков вне пула.
+  vector<unique_ptr<TaskQueue>> queues_;
+  vector<thread> workers_;
+  atomic<size_t> count_of_queued_ = 0;
+  atomic<size_t> count_of_sleeping_ = 0;
+  mutex sleep_mutex_;
+  condition_variable wake_up_;
+  bool is_stopped_ = false;
+
+  // Номер очереди текущего потока в пуле.
+  static inline thread_local size_t queue_index_ = numeric_limits<size_t>::max();
+
+  explicit ThreadPool(size_t count_of_threads) {
+    for (size_t i = 0; i < count_of_threads; ++i) {
+      queues_.push_back(make_unique<TaskQueue>());
+    }
+    for (size_t i = 0; i + 1 < count_of_threads; ++i) {
+      workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
     }
-    return list_of_edges;
   }
 
-  // Рекурсивный обход графа dfs.
-  void RecursionDfs(vector<bool> &is_used_vertex, size_t current_vertex, vector<int> &current_vertexes) {
-    is_used_vertex[current_vertex] = true;
-    current_vertexes.push_back(static_cast<int>(current_vertex));
-    for (size_t i = 0; i < count_of_vertexes_; ++i)
-      if (adjacency_matrix_[current_vertex][i] && !is_used_vertex[i])
-        RecursionDfs(is_used_vertex, i, current_vertexes);
+  size_t QueueIndex() const {
+    return queue_index_ < queues_.size() ? queue_index_ : queues_.size() - 1;
   }
 
-  // Нерекурсивный обход графа dfs.
-  void StackDfs(vector<bool> &is_used_vertex, size_t start_vertex, vector<int> &current_vertexes) {
-    current_vertexes.push_back(static_cast<int>(start_vertex));
-    is_used_vertex[start_vertex] = true;
-    stack<size_t> vertexes_stack;
-    vertexes_stack.push(start_vertex);
-    while (!vertexes_stack.empty()) {
-      bool was_add = false;
-      size_t current_vertex = vertexes_stack.top();
-      is_used_vertex[current_vertex] = true;
-      for (size_t i = 0; i < count_of_vertexes_; ++i) {
-        if (adjacency_matrix_[current_vertex][i] && !is_used_vertex[i]) {
-          current_vertexes.push_back(static_cast<int>(i));
-          vertexes_stack.push(i);
-          was_add = true;
-          break;
-        }
+  // Берет задачу из конца своей очереди или крадет из начала чужой и выполняет ее.
+  // Возвращает false, если задач нет ни в одной очереди.
+  bool RunTask() {
+    size_t own = QueueIndex();
+    function<void()> task;
+    {
+      TaskQueue &queue = *queues_[own];
+      lock_guard<mutex> lock(queue.tasks_mutex);
+      if (!queue.tasks.empty()) {
+        task = move(queue.tasks.back());
+        queue.tasks.pop_back();
+      }
+    }
+    for (size_t shift = 1; !task && shift < queues_.size(); ++shift) {
+      TaskQueue &victim = *queues_[(own + shift) % queues_.size()];
+      lock_guard<mutex> lock(victim.tasks_mutex);
+      if (!victim.tasks.empty()) {
+        task = move(victim.tasks.front());
+        victim.tasks.pop_front();
       }
-      if (was_add)
-        continue;
-      vertexes_stack.pop();
     }
+    if (!task)
+      return false;
+    count_of_queued_.fetch_sub(1);
+    task();
+    return true;
   }
 
-  // Обход графа bfs.
-  void Bfs(size_t start_vertex, vector<bool> &is_used_vertex, vector<int> &current_vertexes) {
-    queue<size_t> vertexes_queue;
-    vertexes_queue.push(start_vertex);
-    while (!vertexes_queue.empty()) {
-      size_t current_vertex = vertexes_queue.front();
-      vertexes_queue.pop();
-      if (is_used_vertex[current_vertex])
+  // Цикл потока пула: выполняет задачи, а когда их нет, засыпает до появления новых.
+  void WorkerLoop(size_t index) {
+    queue_index_ = index;
+    while (true) {
+      if (RunTask())
         continue;
-      current_vertexes.push_back(static_cast<int>(current_vertex));
-      is_used_vertex[current_vertex] = true;
-      for (size_t i = 0; i < count_of_vertexes_; ++i) {
-        if (adjacency_matrix_[current_vertex][i] && !is_used_vertex[i]) {
-          vertexes_queue.push(i);
-        }
-      }
+      unique_lock<mutex> lock(sleep_mutex_);
+      count_of_sleeping_.fetch_add(1);
+      wake_up_.wait(lock, [&]() { return is_stopped_ || count_of_queued_.load() != 0; });
+      count_of_sleeping_.fetch_sub(1);
+      if (is_stopped_)
+        return;
     }
   }
+};
 
-  // Консольный вывод графа в виде матрицы смежности.
-  void ConsolePrintAdjacencyMatrix() {
-    cout << "\t";
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      cout << i + 1 << "\t";
-    }
-    cout << endl;
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      cout << i + 1 << "\t";
-      for (size_t j = 0; j < count_of_vertexes_; ++j) {
-        cout << adjacency_matrix_[i][j] << "\t";
-      }
-      cout << endl;
+// Вызывает function(begin, end) для частей диапазона [0, count) в общем пуле потоков.
+// Диапазон делится пополам, пока его длина не меньше 2 * part_size; вторая половина отдается пулу.
+template<typename Function>
+void RunInThreadPool(size_t count, const Function &function, size_t part_size) {
+  ThreadPool &pool = ThreadPool::Instance();
+  ThreadPool::Counter pending = 0;
+  auto run = [&](const auto &self, size_t begin, size_t end) -> void {
+    while (end - begin >= 2 * part_size) {
+      size_t middle = begin + (end - begin) / 2;
+      pool.Submit([&self, middle, end]() { self(self, middle, end); }, pending);
+      end = middle;
     }
+    function(begin, end);
+  };
+  run(run, 0, count);
+  pool.Wait(pending);
+}
+
+// Делит диапазон [0, count) на части не меньше grain и вызывает function(begin, end) для каждой части
+// в общем пуле потоков. Размер части подбирается по длине диапазона и числу потоков.
+template<typename Function>
+void ParallelFor(size_t count, Function function, size_t grain = kMinParallelGrain) {
+  grain = max<size_t>(1, grain);
+  if (CountOfThreads() == 1 || count < 2 * grain) {
+    function(size_t{0}, count);
+    return;
   }
+  RunInThreadPool(count, function, max(grain, count / (CountOfThreads() * kPartsPerThread)));
+}
 
-  // Файловый вывод графа в виде матрицы смежности.
-  void FilePrintAdjacencyMatrix() {
-    ofstream out(output_path_);
-    if (!out.is_open()) {
-      cerr << "Ошибка вывода!" << endl;
-      return;
-    }
-    out << "\t";
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      out << i + 1 << "\t";
-    }
-    out << endl;
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      out << i + 1 << "\t";
-      for (size_t j = 0; j < count_of_vertexes_; ++j) {
-        out << adjacency_matrix_[i][j] << "\t";
-      }
-      out << endl;
-    }
+// Дописывает число в кодировке varint: по 7 бит в байте, старший бит - признак продолжения.
+void EncodeVarint(uint64_t value, vector<uint8_t> &bytes) {
+  while (value >= 0x80) {
+    bytes.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
   }
+  bytes.push_back(static_cast<uint8_t>(value));
+}
 
-  // Консольный вывод графа в виде списка смежности.
-  void ConsolePrintAdjacencyList() {
-    vector<vector<int>> adjacency_list = GetAdjacencyList(count_of_vertexes_, adjacency_matrix_);
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      cout << i + 1 << " | ";
-      for (int v : adjacency_list[i]) {
-        cout << v + 1 << " ";
-      }
-      cout << endl;
-    }
+// Читает число в кодировке varint, начиная с позиции position, и сдвигает позицию за него.
+uint64_t DecodeVarint(const vector<uint8_t> &bytes, size_t &position) {
+  uint64_t value = 0;
+  int shift = 0;
+  while (bytes[position] & 0x80) {
+    value |= static_cast<uint64_t>(bytes[position++] & 0x7F) << shift;
+    shift += 7;
   }
+  value |= static_cast<uint64_t>(bytes[position++]) << shift;
+  return value;
+}
 
-  // Файловый вывод графа в виде списка смежности.
-  void FilePrintAdjacencyList() {
-    ofstream out(output_path_);
-    if (!out.is_open()) {
-      cerr << "Ошибка вывода!" << endl;
-      return;
+// Переводит знаковое число в беззнаковое так, что малые по модулю числа получают короткий varint.
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+// Обратное к ZigZagEncode преобразование.
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Делит диапазон [0, count) на части размера grain, которые потоки пула разбирают и крадут друг у друга
+// по мере освобождения, и вызывает function(begin, end) для каждой части. Подходит для неравномерной работы.
+template<typename Function>
+void ParallelForDynamic(size_t count, Function function, size_t grain = kMinParallelGrain) {
+  grain = max<size_t>(1, grain);
+  if (CountOfThreads() == 1 || count <= grain) {
+    function(size_t{0}, count);
+    return;
+  }
+  RunInThreadPool(count, function, grain);
+}
+
+// Сортирует вектор: части сортируются параллельно, затем попарно сливаются, пока не останется одна.
+template<typename T, typename Compare>
+void ParallelSort(vector<T> &values, Compare compare) {
+  size_t count_of_parts = min(CountOfThreads(), max<size_t>(1, values.size() / kMinParallelGrain));
+  vector<size_t> bounds(count_of_parts + 1);
+  for (size_t part = 0; part <= count_of_parts; ++part) {
+    bounds[part] = values.size() * part / count_of_parts;
+  }
+  auto begin = values.begin();
+  ParallelFor(count_of_parts, [&](size_t first, size_t last) {
+    for (size_t part = first; part < last; ++part) {
+      sort(begin + static_cast<ptrdiff_t>(bounds[part]), begin + static_cast<ptrdiff_t>(bounds[part + 1]), compare);
     }
-    vector<vector<int>> adjacency_list = GetAdjacencyList(count_of_vertexes_, adjacency_matrix_);
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      out << i + 1 << " | ";
-      for (int v : adjacency_list[i]) {
-        out << v + 1 << " ";
+  }, 1);
+  for (size_t width = 1; width < count_of_parts; width *= 2) {
+    size_t count_of_merges = (count_of_parts + 2 * width - 1) / (2 * width);
+    ParallelFor(count_of_merges, [&](size_t first, size_t last) {
+      for (size_t merge = first; merge < last; ++merge) {
+        size_t left = merge * 2 * width;
+        size_t middle = min(count_of_parts, left + width);
+        size_t right = min(count_of_parts, left + 2 * width);
+        inplace_merge(begin + static_cast<ptrdiff_t>(bounds[left]),
+                      begin + static_cast<ptrdiff_t>(bounds[middle]),
+                      begin + static_cast<ptrdiff_t>(bounds[right]),
+                      compare);
       }
-      out << endl;
-    }
+    }, 1);
   }
+}
+
+// Примерный объем текста, который форматирует одна задача при параллельном выводе.
+const size_t kFormatPartSize = 1 << 16;
+
+// Дописывает в буфер десятичную запись числа.
+template<typename Number>
+void AppendNumber(string &buffer, Number value) {
+  char digits[24];
+  auto [end, error] = to_chars(digits, digits + sizeof(digits), value);
+  buffer.append(digits, end);
+}
 
-  // Консольный вывод графа в виде списка ребер.
-  void ConsolePrintListOfEdges() {
-    vector<pair<int, int>> list_of_edges = GetListOfEdges(count_of_vertexes_, adjacency_matrix_, is_orient_);
-    for (auto edge : list_of_edges) {
-      cout << edge.first << " " << edge.second << endl;
+// Выводит count_of_rows строк текста: format_row(row, buffer) дописывает в buffer строку с номером row.
+// Строки делятся на части примерно по kFormatPartSize байт (row_size - примерная длина строки),
+// части форматируются параллельно, каждая в свой буфер, и буферы выводятся по порядку.
+// Чтобы не держать в памяти весь текст, части обрабатываются окнами по kPartsPerThread на поток.
+template<typename Function>
+void FormatRowsInOrder(ostream &out, size_t count_of_rows, size_t row_size, Function format_row) {
+  size_t rows_per_part = max<size_t>(1, kFormatPartSize / max<size_t>(1, row_size));
+  size_t count_of_all_parts = (count_of_rows + rows_per_part - 1) / rows_per_part;
+  vector<string> parts(min(count_of_all_parts, CountOfThreads() * kPartsPerThread));
+  size_t rows_per_window = rows_per_part * parts.size();
+  for (size_t window = 0; window < count_of_rows; window += rows_per_window) {
+    size_t window_end = min(count_of_rows, window + rows_per_window);
+    size_t count_of_parts = (window_end - window + rows_per_part - 1) / rows_per_part;
+    ParallelForDynamic(count_of_parts, [&](size_t begin, size_t end) {
+      for (size_t part = begin; part < end; ++part) {
+        parts[part].clear();
+        size_t first_row = window + part * rows_per_part;
+        size_t last_row = min(window_end, first_row + rows_per_part);
+        for (size_t row = first_row; row < last_row; ++row) {
+          format_row(row, parts[part]);
+        }
+      }
+    }, 1);
+    for (size_t part = 0; part < count_of_parts; ++part) {
+      out.write(parts[part].data(), static_cast<streamsize>(parts[part].size()));
     }
   }
+  out.flush();
+}
 
-  // Файловый вывод графа в виде списка ребер.
-  void FilePrintListOfEdges() {
-    ofstream out(output_path_);
-    if (!out.is_open()) {
-      cerr << "Ошибка вывода!" << endl;
-      return;
-    }
-    vector<pair<int, int>> list_of_edges = GetListOfEdges(count_of_vertexes_, adjacency_matrix_, is_orient_);
-    for (auto edge : list_of_edges) {
-      out << edge.first << " " << edge.second << endl;
+// Система непересекающихся множеств с объединением по размеру и сжатием путей.
+class DisjointSets {
+ private:
+  vector<size_t> parent_;
+  vector<size_t> size_;
+
+ public:
+  // Создает count одноэлементных множеств.
+  explicit DisjointSets(size_t count) : parent_(count), size_(count, 1) {
+    for (size_t i = 0; i < count; ++i) {
+      parent_[i] = i;
     }
   }
 
-  // Консольный вывод графа в виде матрицы инцидентности.
-  void ConsolePrintIncidenceMatrix() {
-    vector<vector<int>>
-        incidence_matrix = GetIncidenceMatrix(count_of_vertexes_, count_of_edges_, adjacency_matrix_, is_orient_);
-    cout << "\t";
-    for (size_t i = 0; i < count_of_edges_; ++i) {
-      cout << i + 1 << "\t";
-    }
-    cout << endl;
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      cout << i + 1 << "\t";
-      for (size_t j = 0; j < count_of_edges_; ++j) {
-        cout << incidence_matrix[i][j] << "\t";
-      }
-      cout << endl;
+  // Добавляет одноэлементные множества, чтобы элементов стало count.
+  void Grow(size_t count) {
+    for (size_t i = parent_.size(); i < count; ++i) {
+      parent_.push_back(i);
+      size_.push_back(1);
     }
   }
 
-  // Файловый вывод графа в виде матрицы инцидентности.
-  void FilePrintIncidenceMatrix() {
-    ofstream out(output_path_);
-    if (!out.is_open()) {
-      cerr << "Ошибка вывода!" << endl;
-      return;
+  // Возвращает корень множества элемента.
+  size_t Find(size_t element) {
+    size_t root = element;
+    while (parent_[root] != root) {
+      root = parent_[root];
     }
-    vector<vector<int>>
-        incidence_matrix = GetIncidenceMatrix(count_of_vertexes_, count_of_edges_, adjacency_matrix_, is_orient_);
-    out << "\t";
-    for (size_t i = 0; i < count_of_edges_; ++i) {
-      out << i + 1 << "\t";
-    }
-    out << endl;
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      out << i + 1 << "\t";
-      for (size_t j = 0; j < count_of_edges_; ++j) {
-        out << incidence_matrix[i][j] << "\t";
-      }
-      out << endl;
+    while (parent_[element] != root) {
+      size_t next = parent_[element];
+      parent_[element] = root;
+      element = next;
     }
+    return root;
   }
 
- public:
-  // Пустой конструктор класса. Просто инициализирует поля дефолтными значениями.
-  Graph() {
-    count_of_vertexes_ = 0;
-    count_of_edges_ = 0;
-    is_orient_ = false;
-    output_path_ = "..";
-    output_path_ += filesystem::path::preferred_separator;
-    output_path_ += "output.txt";
-    input_path_ = "..";
-    input_path_ += filesystem::path::preferred_separator;
-    input_path_ += "input.txt";
+  // Объединяет множества двух элементов. Возвращает false, если они уже были в одном множестве.
+  bool Unite(size_t first, size_t second) {
+    first = Find(first);
+    second = Find(second);
+    if (first == second)
+      return false;
+    if (size_[first] < size_[second])
+      swap(first, second);
+    parent_[second] = first;
+    size_[first] += size_[second];
+    return true;
   }
+};
 
-  // Конструтор класса с параметрами. Инициализирует поля, согласно входным параметрам.
-  Graph(int count_of_vertexes, int count_of_edges, vector<vector<int>> adjacency_matrix, bool is_orient) {
-    count_of_vertexes_ = static_cast<size_t>(count_of_vertexes);
-    count_of_edges_ = static_cast<size_t>(count_of_edges);
-    adjacency_matrix_ = std::move(adjacency_matrix);
-    is_orient_ = is_orient;
-    output_path_ = "..";
-    output_path_ += filesystem::path::preferred_separator;
-    output_path_ += "output.txt";
-    input_path_ = "..";
-    input_path_ += filesystem::path::preferred_separator;
-    input_path_ += "input.txt";
-  }
+// Система непересекающихся множеств, допускающая одновременные объединения из разных потоков.
+// Корень множества всегда подвешивается к корню с меньшим номером, поэтому циклов не возникает.
+class ConcurrentDisjointSets {
+ private:
+  vector<atomic<size_t>> parent_;
 
-  // Вывод графа в виде матрицы смежности, предоставляя выбор способа вывода.
-  void PrintAdjacencyMatrix() {
-    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
-         << "чтобы вывести в файл." << endl << "> ";
-    string output_type;
-    cin >> output_type;
-    if (output_type[0] == '0') {
-      ConsolePrintAdjacencyMatrix();
-      return;
+ public:
+  // Создает count одноэлементных множеств.
+  explicit ConcurrentDisjointSets(size_t count) : parent_(count) {
+    for (size_t i = 0; i < count; ++i) {
+      parent_[i].store(i, memory_order_relaxed);
     }
-    FilePrintAdjacencyMatrix();
   }
 
-  // Вывод графа в виде списка смежности, предоставляя выбор способа вывода.
-  void PrintAdjacencyList() {
-    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
-         << "чтобы вывести в файл." << endl << "> ";
-    string output_type;
-    cin >> output_type;
-    if (output_type[0] == '0') {
-      ConsolePrintAdjacencyList();
-      return;
+  // Возвращает корень множества элемента, попутно сокращая путь вдвое.
+  size_t Find(size_t element) {
+    while (true) {
+      size_t parent = parent_[element].load(memory_order_relaxed);
+      if (parent == element)
+        return element;
+      size_t grandparent = parent_[parent].load(memory_order_relaxed);
+      if (grandparent != parent)
+        parent_[element].compare_exchange_weak(parent, grandparent, memory_order_relaxed);
+      element = grandparent;
     }
-    FilePrintAdjacencyList();
   }
 
-  // Вывод графа в виде списка ребер, предоставляя выбор способа вывода.
-  void PrintListOfEdges() {
-    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
-         << "чтобы вывести в файл." << endl << "> ";
-    string output_type;
-    cin >> output_type;
-    if (output_type[0] == '0') {
-      ConsolePrintListOfEdges();
-      return;
+  // Объединяет множества двух элементов.
+  void Unite(size_t first, size_t second) {
+    while (true) {
+      first = Find(first);
+      second = Find(second);
+      if (first == second)
+        return;
+      if (first < second)
+        swap(first, second);
+      size_t expected = first;
+      if (parent_[first].compare_exchange_strong(expected, second, memory_order_relaxed))
+        return;
     }
-    FilePrintListOfEdges();
   }
+};
 
-  // Вывод графа в виде матрицы инцидентности, предоставляя выбор способа вывода.
-  void PrintIncidenceMatrix() {
-    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
-         << "чтобы вывести в файл." << endl << "> ";
-    string output_type;
-    cin >> output_type;
-    if (output_type[0] == '0') {
-      ConsolePrintIncidenceMatrix();
-      return;
+// Граф с версиями (MVCC) для запросов, которые идут одновременно с изменениями. Версии неизменяемы:
+// писатель собирает пачку добавлений и удалений дуг в новую версию и публикует ее одним указателем.
+// Читатель закрепляет текущую версию, записав текущую эпоху в свободный слот, и читает ее без блокировок.
+// Старая версия удаляется, когда эпохи всех закрепленных читателей не меньше эпохи ее замены.
+// Списки соседей хранятся кусками по kChunkSize вершин; новая версия копирует только куски
+// с измененными вершинами, а остальные разделяет с предыдущей.
+template<typename VertexId>
+class VersionedGraph {
+ private:
+  static const size_t kChunkSize = 256;
+  static const size_t kCountOfSlots = 256;
+  static constexpr uint64_t kIdle = numeric_limits<uint64_t>::max();
+
+  // Списки соседей и входящие степени вершин одного куска в формате CSR.
+  struct Chunk {
+    vector<size_t> offsets;
+    vector<VertexId> neighbours;
+    vector<size_t> in_degree;
+  };
+
+  // Слот читателя: эпоха, в которую он закрепил версию, или kIdle.
+  struct alignas(64) Slot {
+    atomic<uint64_t> epoch = kIdle;
+  };
+
+ public:
+  // Неизменяемая версия графа.
+  class Version {
+   private:
+    friend class VersionedGraph;
+    uint64_t number_ = 0;
+    size_t count_of_vertexes_ = 0;
+    size_t count_of_arcs_ = 0;
+    vector<shared_ptr<const Chunk>> chunks_;
+
+    const Chunk &ChunkOf(size_t vertex) const {
+      return *chunks_[vertex / kChunkSize];
     }
-    FilePrintIncidenceMatrix();
-  }
 
-  // Реализовывает обход графа, предоставляя выбор способа обхода.
-  void GraphTravelsale(int type_of_travelsale) {
-    ofstream fout;
-    bool is_console = true;
-    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
-         << "чтобы вывести в файл." << endl << "> ";
-    string output_type;
-    cin >> output_type;
-    if (output_type[0] != '0') {
-      fout = ofstream(output_path_);
-      is_console = false;
+   public:
+    // Номер версии; исходный граф имеет номер 0.
+    uint64_t Number() const {
+      return number_;
     }
-    vector<bool> is_used_vertex(count_of_vertexes_, false);
-    int current_component = 0;
-    for (size_t i = 0; i < count_of_vertexes_; ++i)
+
+    size_t CountOfVertexes() const {
+      return count_of_vertexes_;
+    }
+
+    size_t CountOfArcs() const {
+      return count_of_arcs_;
+    }
+
+    size_t OutDegree(size_t vertex) const {
+      const Chunk &chunk = ChunkOf(vertex);
+      return chunk.offsets[vertex % kChunkSize + 1] - chunk.offsets[vertex % kChunkSize];
+    }
+
+    size_t InDegree(size_t vertex) const {
+      return ChunkOf(vertex).in_degree[vertex % kChunkSize];
+    }
+
+    // Вызывает function для каждого соседа вершины в порядке возрастания номеров.
+    template<typename Function>
+    void ForEachNeighbour(size_t vertex, Function function) const {
+      const Chunk &chunk = ChunkOf(vertex);
+      for (size_t k = chunk.offsets[vertex % kChunkSize]; k < chunk.offsets[vertex % kChunkSize + 1]; ++k) {
+        function(static_cast<size_t>(chunk.neighbours[k]));
+      }
+    }
+
+    // Есть ли дуга from -> to.
+    bool HasArc(size_t from, size_t to) const {
+      const Chunk &chunk = ChunkOf(from);
+      auto first = chunk.neighbours.begin() + static_cast<ptrdiff_t>(chunk.offsets[from % kChunkSize]);
+      auto last = chunk.neighbours.begin() + static_cast<ptrdiff_t>(chunk.offsets[from % kChunkSize + 1]);
+      return binary_search(first, last, static_cast<VertexId>(to));
+    }
+
+    // Находит расстояние в ребрах от вершины from до вершины to или numeric_limits<size_t>::max(),
+    // если to недостижима. Посещенные вершины отмечаются номером запроса в массиве своего потока.
+    size_t BfsDistance(size_t from, size_t to) const {
+      thread_local vector<size_t> visited;
+      thread_local size_t query = 0;
+      if (visited.size() < count_of_vertexes_)
+        visited.resize(count_of_vertexes_, 0);
+      ++query;
+      vector<size_t> frontier = {from};
+      vector<size_t> next_frontier;
+      visited[from] = query;
+      for (size_t level = 0; !frontier.empty(); ++level) {
+        for (size_t current_vertex : frontier) {
+          if (current_vertex == to)
+            return level;
+          ForEachNeighbour(current_vertex, [&](size_t i) {
+            if (visited[i] == query)
+              return;
+            visited[i] = query;
+            next_frontier.push_back(i);
+          });
+        }
+        frontier.swap(next_frontier);
+        next_frontier.clear();
+      }
+      return numeric_limits<size_t>::max();
+    }
+  };
+
+  // Закрепленная версия: пока объект существует, версия не удаляется.
+  class Snapshot {
+   private:
+    Slot *slot_;
+    const Version *version_;
+
+   public:
+    Snapshot(Slot *slot, const Version *version) : slot_(slot), version_(version) {}
+
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    Snapshot(Snapshot &&other) noexcept : slot_(other.slot_), version_(other.version_) {
+      other.slot_ = nullptr;
+    }
+
+    ~Snapshot() {
+      if (slot_)
+        slot_->epoch.store(kIdle);
+    }
+
+    const Version &operator*() const {
+      return *version_;
+    }
+
+    const Version *operator->() const {
+      return version_;
+    }
+  };
+
+  // Создает версию 0 из графа graph, у которого есть CountOfVertexes, IsOrient и GetNeighbours.
+  template<typename SourceGraph>
+  explicit VersionedGraph(const SourceGraph &graph) : is_orient_(graph.IsOrient()) {
+    auto version = make_unique<Version>();
+    size_t n = graph.CountOfVertexes();
+    vector<shared_ptr<Chunk>> chunks((n + kChunkSize - 1) / kChunkSize);
+    vector<size_t> in_degree(n, 0);
+    ParallelFor(chunks.size(), [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) {
+        chunks[c] = make_shared<Chunk>();
+        Chunk &chunk = *chunks[c];
+        chunk.offsets.assign(1, 0);
+        for (size_t v = c * kChunkSize; v < min(n, (c + 1) * kChunkSize); ++v) {
+          for (size_t neighbour : graph.GetNeighbours(v)) {
+            chunk.neighbours.push_back(static_cast<VertexId>(neighbour));
+          }
+          chunk.offsets.push_back(chunk.neighbours.size());
+        }
+      }
+    }, 1);
+    for (const auto &chunk : chunks) {
+      for (VertexId neighbour : chunk->neighbours) {
+        in_degree[neighbour]++;
+      }
+      version->count_of_arcs_ += chunk->neighbours.size();
+    }
+    for (size_t c = 0; c < chunks.size(); ++c) {
+      chunks[c]->in_degree.assign(in_degree.begin() + static_cast<ptrdiff_t>(c * kChunkSize),
+                                  in_degree.begin() + static_cast<ptrdiff_t>(min(n, (c + 1) * kChunkSize)));
+    }
+    version->count_of_vertexes_ = n;
+    version->chunks_.assign(chunks.begin(), chunks.end());
+    current_.store(version.release());
+  }
+
+  VersionedGraph(const VersionedGraph &) = delete;
+  VersionedGraph &operator=(const VersionedGraph &) = delete;
+
+  ~VersionedGraph() {
+    delete current_.load();
+  }
+
+  // Закрепляет текущую версию. Не блокируется, пока есть свободный слот читателя.
+  Snapshot Pin() const {
+    thread_local size_t hint = 0;
+    for (size_t attempt = 0;; ++attempt) {
+      size_t index = (hint + attempt) % kCountOfSlots;
+      uint64_t idle = kIdle;
+      uint64_t epoch = epoch_.load();
+      if (slots_[index].epoch.compare_exchange_strong(idle, epoch)) {
+        hint = index;
+        return Snapshot(&slots_[index], current_.load());
+      }
+      if (index + 1 == kCountOfSlots)
+        this_thread::yield();
+    }
+  }
+
+  // Применяет пачку изменений одной новой версией: сначала удаляются дуги erased, затем добавляются
+  // дуги inserted (в неориентированном графе - ребра). Возвращает false и не меняет граф, если в пачке
+  // есть несуществующая вершина; иначе записывает в number номер новой версии.
+  bool ApplyBatch(const vector<Arc> &inserted, const vector<Arc> &erased, uint64_t &number) {
+    lock_guard<mutex> lock(writer_mutex_);
+    const Version &old_version = *current_.load();
+    size_t n = old_version.count_of_vertexes_;
+    auto normalize = [&](const vector<Arc> &arcs, vector<Arc> &result) {
+      for (auto arc : arcs) {
+        if (arc.first >= n || arc.second >= n)
+          return false;
+        result.push_back(arc);
+        if (!is_orient_)
+          result.emplace_back(arc.second, arc.first);
+      }
+      sort(result.begin(), result.end());
+      result.erase(unique(result.begin(), result.end()), result.end());
+      return true;
+    };
+    vector<Arc> to_insert;
+    vector<Arc> to_erase;
+    if (!normalize(inserted, to_insert) || !normalize(erased, to_erase))
+      return false;
+    // Настоящие изменения относительно старой версии.
+    vector<Arc> added;
+    vector<Arc> removed;
+    for (auto arc : to_insert) {
+      if (!old_version.HasArc(arc.first, arc.second))
+        added.push_back(arc);
+    }
+    for (auto arc : to_erase) {
+      if (old_version.HasArc(arc.first, arc.second) && !binary_search(to_insert.begin(), to_insert.end(), arc))
+        removed.push_back(arc);
+    }
+    // Изменения входящих степеней по концам дуг.
+    vector<pair<size_t, int>> degree_changes;
+    for (auto arc : added) {
+      degree_changes.emplace_back(arc.second, 1);
+    }
+    for (auto arc : removed) {
+      degree_changes.emplace_back(arc.second, -1);
+    }
+    sort(degree_changes.begin(), degree_changes.end());
+    vector<size_t> touched;
+    for (const auto *arcs : {&added, &removed}) {
+      for (auto arc : *arcs) {
+        touched.push_back(arc.first / kChunkSize);
+        touched.push_back(arc.second / kChunkSize);
+      }
+    }
+    sort(touched.begin(), touched.end());
+    touched.erase(unique(touched.begin(), touched.end()), touched.end());
+    auto version = make_unique<Version>(old_version);
+    version->number_ = old_version.number_ + 1;
+    version->count_of_arcs_ = old_version.count_of_arcs_ + added.size() - removed.size();
+    ParallelFor(touched.size(), [&](size_t begin, size_t end) {
+      for (size_t t = begin; t < end; ++t) {
+        size_t c = touched[t];
+        const Chunk &old_chunk = *old_version.chunks_[c];
+        auto chunk = make_shared<Chunk>();
+        chunk->offsets.assign(1, 0);
+        chunk->in_degree = old_chunk.in_degree;
+        size_t first_vertex = c * kChunkSize;
+        size_t last_vertex = min(n, first_vertex + kChunkSize);
+        vector<VertexId> kept;
+        for (size_t v = first_vertex; v < last_vertex; ++v) {
+          auto old_first = old_chunk.neighbours.begin() + static_cast<ptrdiff_t>(old_chunk.offsets[v - first_vertex]);
+          auto old_last = old_chunk.neighbours.begin() + static_cast<ptrdiff_t>(old_chunk.offsets[v - first_vertex + 1]);
+          auto removed_first = lower_bound(removed.begin(), removed.end(), Arc{v, 0});
+          auto removed_last = lower_bound(removed_first, removed.end(), Arc{v + 1, 0});
+          auto added_first = lower_bound(added.begin(), added.end(), Arc{v, 0});
+          auto added_last = lower_bound(added_first, added.end(), Arc{v + 1, 0});
+          kept.clear();
+          auto removed_it = removed_first;
+          for (auto it = old_first; it != old_last; ++it) {
+            while (removed_it != removed_last && removed_it->second < *it) {
+              ++removed_it;
+            }
+            if (removed_it == removed_last || removed_it->second != *it)
+              kept.push_back(*it);
+          }
+          auto kept_it = kept.begin();
+          for (auto added_it = added_first; added_it != added_last; ++added_it) {
+            for (; kept_it != kept.end() && *kept_it < added_it->second; ++kept_it) {
+              chunk->neighbours.push_back(*kept_it);
+            }
+            chunk->neighbours.push_back(static_cast<VertexId>(added_it->second));
+          }
+          chunk->neighbours.insert(chunk->neighbours.end(), kept_it, kept.end());
+          chunk->offsets.push_back(chunk->neighbours.size());
+        }
+        auto changes_first = lower_bound(degree_changes.begin(), degree_changes.end(), pair<size_t, int>{first_vertex, -1});
+        auto changes_last = lower_bound(changes_first, degree_changes.end(), pair<size_t, int>{last_vertex, -1});
+        for (auto it = changes_first; it != changes_last; ++it) {
+          chunk->in_degree[it->first - first_vertex] += static_cast<size_t>(it->second);
+        }
+        version->chunks_[c] = move(chunk);
+      }
+    }, 1);
+    number = version->number_;
+    const Version *old_pointer = current_.exchange(version.release());
+    epoch_.store(number);
+    retired_.emplace_back(number, unique_ptr<const Version>(old_pointer));
+    Reclaim();
+    return true;
+  }
+
+ private:
+  bool is_orient_;
+  atomic<const Version *> current_ = nullptr;
+  // Эпоха - номер последней опубликованной версии.
+  atomic<uint64_t> epoch_ = 0;
+  mutable array<Slot, kCountOfSlots> slots_;
+  mutex writer_mutex_;
+  // Замененные версии вместе с эпохой замены, ожидающие удаления.
+  vector<pair<uint64_t, unique_ptr<const Version>>> retired_;
+
+  // Удаляет замененные версии, которые не может видеть ни один закрепленный читатель.
+  void Reclaim() {
+    uint64_t min_epoch = kIdle;
+    for (const auto &slot : slots_) {
+      min_epoch = min(min_epoch, slot.epoch.load());
+    }
+    erase_if(retired_, [&](const auto &retired) { return retired.first <= min_epoch; });
+  }
+};
+
+// Размер одного буфера вывода в файл.
+const size_t kOutputBufferSize = 1 << 20;
+
+// Количество буферов вывода: один заполняется, остальные ждут записи или пишутся.
+const size_t kOutputBufferCount = 3;
+
+// Буфер вывода в файл, который пишет на диск в отдельном потоке. Заполненный буфер отдается
+// потоку записи, а вывод продолжается в свободный буфер из пула, поэтому форматирование
+// не ждет диска. Сброс потока (endl, flush) неполный буфер не отправляет: данные уходят
+// на диск целыми буферами и при закрытии.
+class AsyncOutputBuffer : public streambuf {
+ private:
+  FILE *file_ = nullptr;
+  array<vector<char>, kOutputBufferCount> buffers_;
+  size_t current_ = 0;
+  deque<size_t> free_buffers_;
+  // Заполненные буферы в порядке вывода: номер буфера и размер данных в нем.
+  deque<pair<size_t, size_t>> filled_buffers_;
+  bool is_closing_ = false;
+  bool is_failed_ = false;
+  mutex mutex_;
+  condition_variable condition_;
+  thread writer_;
+
+  // Пишет заполненные буферы по порядку, пока буфер не закроют.
+  void WriteBuffers() {
+    unique_lock<mutex> lock(mutex_);
+    while (true) {
+      condition_.wait(lock, [&] { return is_closing_ || !filled_buffers_.empty(); });
+      if (filled_buffers_.empty())
+        return;
+      auto [index, size] = filled_buffers_.front();
+      filled_buffers_.pop_front();
+      lock.unlock();
+      bool is_written = fwrite(buffers_[index].data(), 1, size, file_) == size;
+      lock.lock();
+      is_failed_ = is_failed_ || !is_written;
+      free_buffers_.push_back(index);
+      condition_.notify_all();
+    }
+  }
+
+  // Отдает заполненную часть текущего буфера потоку записи. Если need_next, ждет свободный буфер.
+  void SubmitCurrent(bool need_next) {
+    size_t size = static_cast<size_t>(pptr() - pbase());
+    unique_lock<mutex> lock(mutex_);
+    if (size != 0) {
+      filled_buffers_.emplace_back(current_, size);
+      condition_.notify_all();
+      if (need_next) {
+        condition_.wait(lock, [&] { return !free_buffers_.empty(); });
+        current_ = free_buffers_.front();
+        free_buffers_.pop_front();
+      }
+    }
+    setp(buffers_[current_].data(), buffers_[current_].data() + kOutputBufferSize);
+  }
+
+ protected:
+  int_type overflow(int_type symbol) override {
+    if (file_ == nullptr)
+      return traits_type::eof();
+    SubmitCurrent(true);
+    if (!traits_type::eq_int_type(symbol, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(symbol);
+      pbump(1);
+    }
+    return traits_type::not_eof(symbol);
+  }
+
+  int sync() override {
+    return file_ == nullptr ? -1 : 0;
+  }
+
+ public:
+  AsyncOutputBuffer() = default;
+  AsyncOutputBuffer(const AsyncOutputBuffer &) = delete;
+  AsyncOutputBuffer &operator=(const AsyncOutputBuffer &) = delete;
+
+  ~AsyncOutputBuffer() override {
+    Close(false);
+  }
+
+  // Открывает файл и запускает поток записи. Возвращает false, если файл не открылся.
+  bool Open(const string &path) {
+    Close(false);
+    file_ = fopen(path.c_str(), "w");
+    if (file_ == nullptr)
+      return false;
+    setvbuf(file_, nullptr, _IONBF, 0);
+    for (auto &buffer : buffers_) {
+      buffer.resize(kOutputBufferSize);
+    }
+    current_ = 0;
+    free_buffers_.clear();
+    for (size_t i = 1; i < kOutputBufferCount; ++i) {
+      free_buffers_.push_back(i);
+    }
+    is_closing_ = false;
+    is_failed_ = false;
+    setp(buffers_[current_].data(), buffers_[current_].data() + kOutputBufferSize);
+    writer_ = thread([this] { WriteBuffers(); });
+    return true;
+  }
+
+  // Дописывает оставшиеся данные и закрывает файл; при is_durable сбрасывает его на диск.
+  // Возвращает false, если что-то не записалось.
+  bool Close(bool is_durable) {
+    if (file_ == nullptr)
+      return true;
+    SubmitCurrent(false);
+    {
+      lock_guard<mutex> lock(mutex_);
+      is_closing_ = true;
+      condition_.notify_all();
+    }
+    writer_.join();
+    bool is_correct = !is_failed_ && fflush(file_) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+    if (is_durable && is_correct)
+      is_correct = fsync(fileno(file_)) == 0;
+#endif
+    is_correct = fclose(file_) == 0 && is_correct;
+    file_ = nullptr;
+    setp(nullptr, nullptr);
+    return is_correct;
+  }
+};
+
+// Поток вывода в файл через AsyncOutputBuffer. При закрытии файл сбрасывается на диск,
+// если задана переменная окружения GRAPH_FSYNC.
+class AsyncFileStream : public ostream {
+ private:
+  AsyncOutputBuffer buffer_;
+
+ public:
+  AsyncFileStream() : ostream(nullptr) {}
+
+  explicit AsyncFileStream(const string &path) : AsyncFileStream() {
+    Open(path);
+  }
+
+  ~AsyncFileStream() override {
+    Close();
+  }
+
+  // Открывает файл для вывода.
+  void Open(const string &path) {
+    if (buffer_.Open(path)) {
+      rdbuf(&buffer_);
+      clear();
+    } else {
+      rdbuf(nullptr);
+    }
+  }
+
+  // Возвращает true, если файл открыт.
+  bool IsOpen() const {
+    return rdbuf() != nullptr;
+  }
+
+  // Дописывает и закрывает файл. Возвращает false, если вывод не удался.
+  bool Close() {
+    if (!IsOpen())
+      return true;
+    bool is_correct = buffer_.Close(IsFsyncRequested()) && !fail();
+    rdbuf(nullptr);
+    return is_correct;
+  }
+};
+
+// Массив списков соседей графа. Либо владеет своей памятью, либо без копирования читает чужую:
+// сегмент разделяемой памяти или отображенный файл, который остается отображенным, пока на него
+// указывает хотя бы один массив. Доступ по индексу - только для чтения; писать можно через
+// MutableData(), которая, как и изменение размера, сначала копирует чужие данные к себе.
+template<typename T>
+class GraphArray {
+ private:
+  vector<T> owned_;
+  const T *data_ = nullptr;
+  size_t size_ = 0;
+  shared_ptr<const void> mapping_;
+
+  // Указывает на собственную память после ее изменения.
+  void Sync() {
+    data_ = owned_.data();
+    size_ = owned_.size();
+  }
+
+  // Копирует чужие данные в собственную память перед изменением размера.
+  void Own() {
+    if (!mapping_)
+      return;
+    owned_.assign(data_, data_ + size_);
+    mapping_.reset();
+    Sync();
+  }
+
+ public:
+  GraphArray() = default;
+
+  GraphArray(const GraphArray &other)
+      : owned_(other.owned_), data_(other.data_), size_(other.size_), mapping_(other.mapping_) {
+    if (!mapping_)
+      Sync();
+  }
+
+  GraphArray(GraphArray &&other) noexcept
+      : owned_(move(other.owned_)), data_(other.data_), size_(other.size_), mapping_(move(other.mapping_)) {
+    if (!mapping_)
+      Sync();
+    other.Sync();
+  }
+
+  GraphArray &operator=(GraphArray other) {
+    owned_ = move(other.owned_);
+    data_ = other.data_;
+    size_ = other.size_;
+    mapping_ = move(other.mapping_);
+    if (!mapping_)
+      Sync();
+    return *this;
+  }
+
+  // Начинает читать size элементов по адресу data внутри отображенной памяти mapping.
+  void Attach(shared_ptr<const void> mapping, const T *data, size_t size) {
+    vector<T>().swap(owned_);
+    mapping_ = move(mapping);
+    data_ = data;
+    size_ = size;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  const T *data() const {
+    return data_;
+  }
+
+  // Возвращает указатель для записи, скопировав чужие данные в собственную память.
+  T *MutableData() {
+    Own();
+    return owned_.data();
+  }
+
+  const T &operator[](size_t i) const {
+    return data_[i];
+  }
+
+  const T *begin() const {
+    return data_;
+  }
+
+  const T *end() const {
+    return data_ + size_;
+  }
+
+  void assign(size_t count, const T &value) {
+    mapping_.reset();
+    owned_.assign(count, value);
+    Sync();
+  }
+
+  void resize(size_t count) {
+    Own();
+    owned_.resize(count);
+    Sync();
+  }
+
+  void shrink_to_fit() {
+    owned_.shrink_to_fit();
+    if (!mapping_)
+      Sync();
+  }
+
+  // Освобождает память массива.
+  void clear() {
+    vector<T>().swap(owned_);
+    mapping_.reset();
+    Sync();
+  }
+};
+
+// Отметка в начале опубликованного графа.
+const uint64_t kSharedGraphMagic = 0x314850415247ULL;
+
+// Заголовок графа, опубликованного в разделяемой памяти или файле. Массивы лежат после заголовка
+// и задаются смещениями в байтах от его начала, поэтому сегмент можно отобразить по любому адресу.
+struct SharedGraphHeader {
+  uint64_t magic;
+  uint64_t vertex_id_size;
+  uint64_t edge_index_size;
+  uint64_t count_of_vertexes;
+  uint64_t count_of_edges;
+  uint64_t count_of_arcs;
+  uint64_t is_orient;
+  uint64_t is_weighted;
+  uint64_t offsets_position;
+  uint64_t neighbours_position;
+  uint64_t weights_position;
+  uint64_t total_size;
+};
+
+// Сжатые списки соседей всех вершин. Список вершины v начинается с байта offsets[v]: количество
+// соседей, затем для каждого соседа разность с предыдущим номером и, во взвешенном графе, вес
+// в кодировке zigzag; все числа записаны в кодировке varint.
+struct CompressedLists {
+  vector<uint8_t> bytes;
+  vector<uint64_t> offsets;
+  size_t count_of_arcs = 0;
+  bool is_weighted = false;
+};
+
+// Дописывает в lists список соседей очередной вершины; neighbours - пары (сосед, вес) по возрастанию.
+void AppendCompressedList(const vector<pair<size_t, Weight>> &neighbours, CompressedLists &lists) {
+  lists.offsets.push_back(lists.bytes.size());
+  EncodeVarint(neighbours.size(), lists.bytes);
+  size_t previous = 0;
+  for (auto [neighbour, weight] : neighbours) {
+    EncodeVarint(neighbour - previous, lists.bytes);
+    previous = neighbour;
+    if (lists.is_weighted)
+      EncodeVarint(ZigZagEncode(weight), lists.bytes);
+  }
+  lists.count_of_arcs += neighbours.size();
+}
+
+// Класс, реализующий работу с графами.
+// VertexId - тип номера вершины, EdgeIndex - тип смещения в массиве соседей.
+template<typename VertexId, typename EdgeIndex>
+class Graph {
+ private:
+  // Количество ввершин
+  size_t count_of_vertexes_;
+  size_t count_of_edges_;
+  bool is_orient_;
+  string output_path_;
+  string input_path_;
+  string index_path_;
+  // Списки соседей в формате CSR: соседи вершины v лежат
+  // в neighbours_[offsets_[v]] .. neighbours_[offsets_[v + 1] - 1] по возрастанию.
+  GraphArray<EdgeIndex> offsets_;
+  GraphArray<VertexId> neighbours_;
+  // Веса дуг взвешенного графа, в том же порядке, что и соседи.
+  bool is_weighted_;
+  GraphArray<Weight> weights_;
+  // Сжатое хранение (см. CompressedLists): offsets_, neighbours_ и weights_ пусты, список вершины v
+  // начинается с байта compressed_offsets_[v] массива compressed_neighbours_.
+  bool is_compressed_;
+  vector<uint8_t> compressed_neighbours_;
+  vector<EdgeIndex> compressed_offsets_;
+  size_t count_of_compressed_arcs_;
+  // Транзитивное замыкание: компонента сильной связности каждой вершины и упакованная битовая матрица
+  // достижимости между компонентами (closure_words_ слов на строку). Строится при первом запросе.
+  bool has_closure_;
+  vector<size_t> closure_component_;
+  size_t closure_words_;
+  vector<uint64_t> closure_;
+
+  // Производные представления графа. Каждое строится при первом обращении, после чего
+  // переиспользуется всеми операциями, пока списки соседей не изменятся.
+  struct DerivedViews {
+    bool has_adjacency_list = false;
+    vector<vector<VertexId>> adjacency_list;
+    bool has_list_of_edges = false;
+    vector<pair<VertexId, VertexId>> list_of_edges;
+    vector<Weight> edge_weights;
+    bool has_incidence_matrix = false;
+    vector<vector<int>> incidence_matrix;
+    bool has_in_degrees = false;
+    vector<EdgeIndex> in_degree;
+    // Обратные списки соседей в формате CSR.
+    bool has_reverse_neighbours = false;
+    vector<EdgeIndex> reverse_offsets;
+    vector<VertexId> reverse_neighbours;
+  };
+  DerivedViews views_;
+
+  // Количество интервальных меток GRAIL у каждой компоненты.
+  static const size_t kCountOfLabels = 5;
+
+  // Индекс достижимости GRAIL над конденсацией графа. Каждый из kCountOfLabels обходов dfs
+  // со случайным порядком соседей дает компоненте интервал [low, post]; если u достигает v,
+  // то интервал v вложен в интервал u в каждой метке. Обратное неверно, поэтому при вложенности
+  // всех меток выполняется dfs по конденсации, отсекающий компоненты с неподходящими метками.
+  struct ReachabilityIndex {
+    vector<VertexId> component;
+    // Конденсация в формате CSR.
+    vector<EdgeIndex> dag_offsets;
+    vector<VertexId> dag_targets;
+    // Метки компоненты c лежат в labels[c * kCountOfLabels] .. labels[c * kCountOfLabels + kCountOfLabels - 1].
+    vector<pair<VertexId, VertexId>> labels;
+  };
+  bool has_reachability_index_;
+  ReachabilityIndex reachability_index_;
+
+  // Позиция в списке соседей вершины, общая для обычного и сжатого хранения.
+  // weight - вес дуги к последнему выданному соседу.
+  struct NeighbourCursor {
+    EdgeIndex position;
+    EdgeIndex end;
+    size_t byte;
+    size_t previous;
+    Weight weight;
+  };
+
+  // Возвращает курсор на начало списка соседей вершины.
+  NeighbourCursor NeighboursBegin(size_t vertex) const {
+    if (!is_compressed_)
+      return {offsets_[vertex], offsets_[vertex + 1], 0, 0, 1};
+    size_t byte = compressed_offsets_[vertex];
+    auto degree = static_cast<EdgeIndex>(DecodeVarint(compressed_neighbours_, byte));
+    return {0, degree, byte, 0, 1};
+  }
+
+  // Достает очередного соседа по курсору. Возвращает false, если соседи закончились.
+  bool NextNeighbour(NeighbourCursor &cursor, size_t &neighbour) const {
+    if (cursor.position == cursor.end)
+      return false;
+    if (is_compressed_) {
+      cursor.previous += DecodeVarint(compressed_neighbours_, cursor.byte);
+      neighbour = cursor.previous;
+      if (is_weighted_)
+        cursor.weight = ZigZagDecode(DecodeVarint(compressed_neighbours_, cursor.byte));
+    } else {
+      neighbour = neighbours_[cursor.position];
+      if (is_weighted_)
+        cursor.weight = weights_[cursor.position];
+    }
+    ++cursor.position;
+    return true;
+  }
+
+  // Количество дуг во всех списках соседей.
+  size_t CountOfArcs() const {
+    return is_compressed_ ? count_of_compressed_arcs_ : static_cast<size_t>(offsets_[count_of_vertexes_]);
+  }
+
+  // Вызывает function для каждого соседа вершины в порядке возрастания номеров.
+  template<typename Function>
+  void ForEachNeighbour(size_t vertex, Function function) const {
+    if (!is_compressed_) {
+      for (EdgeIndex k = offsets_[vertex]; k < offsets_[vertex + 1]; ++k)
+        function(static_cast<size_t>(neighbours_[k]));
+      return;
+    }
+    NeighbourCursor cursor = NeighboursBegin(vertex);
+    size_t neighbour;
+    while (NextNeighbour(cursor, neighbour))
+      function(neighbour);
+  }
+
+  // Вызывает function(сосед, вес дуги) для каждого соседа вершины.
+  template<typename Function>
+  void ForEachWeightedNeighbour(size_t vertex, Function function) const {
+    if (!is_compressed_) {
+      for (EdgeIndex k = offsets_[vertex]; k < offsets_[vertex + 1]; ++k)
+        function(static_cast<size_t>(neighbours_[k]), is_weighted_ ? weights_[k] : Weight{1});
+      return;
+    }
+    NeighbourCursor cursor = NeighboursBegin(vertex);
+    size_t neighbour;
+    while (NextNeighbour(cursor, neighbour))
+      function(neighbour, cursor.weight);
+  }
+
+  // Проверяет, есть ли в графе дуги отрицательного веса.
+  bool HasNegativeWeights() const {
+    if (!is_weighted_)
+      return false;
+    if (!is_compressed_)
+      return any_of(weights_.begin(), weights_.end(), [](Weight weight) { return weight < 0; });
+    bool has_negative = false;
+    for (size_t i = 0; i < count_of_vertexes_ && !has_negative; ++i) {
+      ForEachWeightedNeighbour(i, [&](size_t, Weight weight) { has_negative = has_negative || weight < 0; });
+    }
+    return has_negative;
+  }
+
+  // Спрашивает способ вывода и при выводе в файл открывает его. Возвращает поток для вывода.
+  ostream &ChooseOutput(AsyncFileStream &fout) {
+    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
+         << "чтобы вывести в файл." << endl << "> ";
+    string output_type;
+    cin >> output_type;
+    if (output_type[0] == '0')
+      return cout;
+    fout.Open(output_path_);
+    return fout;
+  }
+
+  // Считывает с консоли номер вершины. Возвращает false, если такой вершины нет.
+  bool ReadVertex(const string &prompt, size_t &vertex) {
+    cout << prompt << endl << "> ";
+    cin >> vertex;
+    if (!cin || vertex < 1 || vertex > count_of_vertexes_) {
+      cin.clear();
+      cerr << "Неверный номер вершины!" << endl;
+      return false;
+    }
+    --vertex;
+    return true;
+  }
+
+  // Строит списки соседей по набору дуг, отбрасывая повторы.
+  // Если заданы веса дуг, из повторяющихся дуг остается дуга с наименьшим весом.
+  void BuildNeighbours(const vector<Arc> &arcs, const vector<Weight> &arc_weights) {
+    InvalidateDerivedViews();
+    if (!arc_weights.empty()) {
+      BuildWeightedNeighbours(arcs, arc_weights);
+      return;
+    }
+    vector<size_t> begin(count_of_vertexes_ + 1, 0);
+    for (auto arc : arcs) {
+      begin[arc.first + 1]++;
+    }
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      begin[i + 1] += begin[i];
+    }
+    vector<size_t> position(begin.begin(), begin.end() - 1);
+    neighbours_.resize(arcs.size());
+    VertexId *neighbours = neighbours_.MutableData();
+    for (auto arc : arcs) {
+      neighbours[position[arc.first]++] = static_cast<VertexId>(arc.second);
+    }
+    offsets_.assign(count_of_vertexes_ + 1, 0);
+    EdgeIndex *offsets = offsets_.MutableData();
+    ParallelFor(count_of_vertexes_, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        VertexId *first = neighbours + begin[i];
+        VertexId *last = neighbours + begin[i + 1];
+        sort(first, last);
+        offsets[i + 1] = static_cast<EdgeIndex>(unique(first, last) - first);
+      }
+    });
+    size_t size = 0;
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      VertexId *first = neighbours + begin[i];
+      move(first, first + offsets[i + 1], neighbours + size);
+      size += offsets[i + 1];
+      offsets[i + 1] = static_cast<EdgeIndex>(size);
+    }
+    neighbours_.resize(size);
+    neighbours_.shrink_to_fit();
+  }
+
+  // Строит списки соседей вместе с весами дуг.
+  void BuildWeightedNeighbours(const vector<Arc> &arcs, const vector<Weight> &arc_weights) {
+    is_weighted_ = true;
+    vector<size_t> begin(count_of_vertexes_ + 1, 0);
+    for (auto arc : arcs) {
+      begin[arc.first + 1]++;
+    }
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      begin[i + 1] += begin[i];
+    }
+    vector<size_t> position(begin.begin(), begin.end() - 1);
+    vector<pair<VertexId, Weight>> weighted_neighbours(arcs.size());
+    for (size_t k = 0; k < arcs.size(); ++k) {
+      weighted_neighbours[position[arcs[k].first]++] = {static_cast<VertexId>(arcs[k].second), arc_weights[k]};
+    }
+    offsets_.assign(count_of_vertexes_ + 1, 0);
+    EdgeIndex *offsets = offsets_.MutableData();
+    ParallelFor(count_of_vertexes_, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        auto first = weighted_neighbours.begin() + static_cast<ptrdiff_t>(begin[i]);
+        auto last = weighted_neighbours.begin() + static_cast<ptrdiff_t>(begin[i + 1]);
+        sort(first, last);
+        size_t count_of_unique = 0;
+        for (auto it = first; it != last; ++it) {
+          if (it == first || it->first != prev(it)->first)
+            ++count_of_unique;
+        }
+        offsets[i + 1] = static_cast<EdgeIndex>(count_of_unique);
+      }
+    });
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      offsets[i + 1] = static_cast<EdgeIndex>(offsets[i + 1] + offsets[i]);
+    }
+    neighbours_.resize(offsets[count_of_vertexes_]);
+    weights_.resize(offsets[count_of_vertexes_]);
+    VertexId *neighbours = neighbours_.MutableData();
+    Weight *weights = weights_.MutableData();
+    ParallelFor(count_of_vertexes_, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        auto first = weighted_neighbours.begin() + static_cast<ptrdiff_t>(begin[i]);
+        auto last = weighted_neighbours.begin() + static_cast<ptrdiff_t>(begin[i + 1]);
+        EdgeIndex k = offsets_[i];
+        for (auto it = first; it != last; ++it) {
+          if (it != first && it->first == prev(it)->first)
+            continue;
+          neighbours[k] = it->first;
+          weights[k++] = it->second;
+        }
+      }
+    });
+    neighbours_.shrink_to_fit();
+    weights_.shrink_to_fit();
+  }
+
+  // Переходит на сжатое хранение списков lists и освобождает обычные списки соседей.
+  void UseCompressedLists(CompressedLists &&lists) {
+    InvalidateDerivedViews();
+    is_weighted_ = lists.is_weighted;
+    count_of_compressed_arcs_ = lists.count_of_arcs;
+    compressed_offsets_.assign(lists.offsets.begin(), lists.offsets.end());
+    vector<uint64_t>().swap(lists.offsets);
+    compressed_neighbours_ = move(lists.bytes);
+    compressed_neighbours_.shrink_to_fit();
+    offsets_.clear();
+    neighbours_.clear();
+    weights_.clear();
+    is_compressed_ = true;
+  }
+
+  // Сбрасывает все производные представления и индексы. Вызывается при каждом изменении списков соседей.
+  void InvalidateDerivedViews() {
+    views_ = DerivedViews();
+    has_closure_ = false;
+    vector<size_t>().swap(closure_component_);
+    vector<uint64_t>().swap(closure_);
+    closure_words_ = 0;
+    has_reachability_index_ = false;
+    reachability_index_ = ReachabilityIndex();
+  }
+
+  // Матрица инцидентности, строится при первом обращении.
+  const vector<vector<int>> &GetIncidenceMatrix() {
+    if (views_.has_incidence_matrix)
+      return views_.incidence_matrix;
+    vector<vector<int>> incidence_matrix(count_of_vertexes_, vector<int>(count_of_edges_, 0));
+    const vector<pair<VertexId, VertexId>> &list_of_edges = GetListOfEdges();
+    for (size_t i = 0; i < list_of_edges.size(); ++i) {
+      size_t vertex_from = list_of_edges[i].first - 1;
+      size_t vertex_to = list_of_edges[i].second - 1;
+      incidence_matrix[vertex_from][i] = is_orient_ ? -1 : 1;
+      incidence_matrix[vertex_to][i] = 1;
+    }
+    views_.incidence_matrix = move(incidence_matrix);
+    views_.has_incidence_matrix = true;
+    return views_.incidence_matrix;
+  }
+
+  // Список смежности, строится при первом обращении.
+  const vector<vector<VertexId>> &GetAdjacencyList() {
+    if (views_.has_adjacency_list)
+      return views_.adjacency_list;
+    vector<vector<VertexId>> adjacency_list(count_of_vertexes_);
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      adjacency_list[i].reserve(OutDegree(i));
+      ForEachNeighbour(i, [&](size_t j) { adjacency_list[i].push_back(static_cast<VertexId>(j)); });
+    }
+    views_.adjacency_list = move(adjacency_list);
+    views_.has_adjacency_list = true;
+    return views_.adjacency_list;
+  }
+
+  // Список ребер (вершины нумеруются с 1) вместе с весами ребер, строится при первом обращении.
+  void BuildListOfEdges() {
+    vector<pair<VertexId, VertexId>> list_of_edges;
+    vector<Weight> weights;
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      ForEachWeightedNeighbour(i, [&](size_t j, Weight weight) {
+        if (!is_orient_ && i >= j)
+          return;
+        list_of_edges.emplace_back(static_cast<VertexId>(i + 1), static_cast<VertexId>(j + 1));
+        weights.push_back(weight);
+      });
+    }
+    views_.list_of_edges = move(list_of_edges);
+    views_.edge_weights = move(weights);
+    views_.has_list_of_edges = true;
+  }
+
+  // Список ребер; вершины нумеруются с 1.
+  const vector<pair<VertexId, VertexId>> &GetListOfEdges() {
+    if (!views_.has_list_of_edges)
+      BuildListOfEdges();
+    return views_.list_of_edges;
+  }
+
+  // Веса ребер в порядке списка ребер.
+  const vector<Weight> &GetEdgeWeights() {
+    if (!views_.has_list_of_edges)
+      BuildListOfEdges();
+    return views_.edge_weights;
+  }
+
+  // Обратные списки соседей (транспонированный граф): для каждой вершины - вершины, из которых
+  // в нее идут дуги, по возрастанию. Строятся параллельно сортировкой подсчетом: вершины-источники
+  // делятся на блоки, каждый блок считает свои дуги в каждую вершину, и по этим счетчикам
+  // каждый блок раскладывает свои дуги в заранее известные позиции без синхронизации.
+  // Блоки идут по возрастанию номеров источников, поэтому списки получаются упорядоченными.
+  // Блоков не больше, чем дуг на вершину, чтобы счетчики занимали не больше памяти, чем сами дуги.
+  void BuildReverseNeighbours() {
+    size_t n = count_of_vertexes_;
+    size_t m = n == 0 ? 0 : CountOfArcs();
+    size_t count_of_blocks = max<size_t>(1, min({CountOfThreads(), n / kMinParallelGrain, n == 0 ? 0 : m / n}));
+    auto block_begin = [&](size_t block) { return block * n / count_of_blocks; };
+    // counts[block * n + j] - сколько дуг блока идет в вершину j, затем - позиция блока в списке вершины j.
+    vector<EdgeIndex> counts(count_of_blocks * n, 0);
+    ParallelFor(count_of_blocks, [&](size_t begin, size_t end) {
+      for (size_t block = begin; block < end; ++block) {
+        EdgeIndex *block_counts = counts.data() + block * n;
+        for (size_t i = block_begin(block); i < block_begin(block + 1); ++i) {
+          ForEachNeighbour(i, [&](size_t j) { block_counts[j]++; });
+        }
+      }
+    }, 1);
+    vector<EdgeIndex> &reverse_offsets = views_.reverse_offsets;
+    reverse_offsets.assign(n + 1, 0);
+    ParallelFor(n, [&](size_t begin, size_t end) {
+      for (size_t j = begin; j < end; ++j) {
+        EdgeIndex position = 0;
+        for (size_t block = 0; block < count_of_blocks; ++block) {
+          EdgeIndex count = counts[block * n + j];
+          counts[block * n + j] = position;
+          position += count;
+        }
+        reverse_offsets[j + 1] = position;
+      }
+    });
+    for (size_t j = 0; j < n; ++j) {
+      reverse_offsets[j + 1] += reverse_offsets[j];
+    }
+    vector<VertexId> &reverse_neighbours = views_.reverse_neighbours;
+    reverse_neighbours.resize(m);
+    ParallelFor(count_of_blocks, [&](size_t begin, size_t end) {
+      for (size_t block = begin; block < end; ++block) {
+        EdgeIndex *block_positions = counts.data() + block * n;
+        for (size_t i = block_begin(block); i < block_begin(block + 1); ++i) {
+          ForEachNeighbour(i, [&](size_t j) {
+            reverse_neighbours[reverse_offsets[j] + block_positions[j]++] = static_cast<VertexId>(i);
+          });
+        }
+      }
+    }, 1);
+    views_.has_reverse_neighbours = true;
+  }
+
+  // Рекурсивный обход графа dfs.
+  void RecursionDfs(vector<bool> &is_used_vertex, size_t current_vertex, vector<VertexId> &current_vertexes) {
+    is_used_vertex[current_vertex] = true;
+    current_vertexes.push_back(static_cast<VertexId>(current_vertex));
+    ForEachNeighbour(current_vertex, [&](size_t i) {
+      if (!is_used_vertex[i])
+        RecursionDfs(is_used_vertex, i, current_vertexes);
+    });
+  }
+
+  // Нерекурсивный обход графа dfs.
+  // Для каждой вершины стека хранится курсор на ее следующего непросмотренного соседа.
+  void StackDfs(vector<bool> &is_used_vertex, size_t start_vertex, vector<VertexId> &current_vertexes) {
+    current_vertexes.push_back(static_cast<VertexId>(start_vertex));
+    is_used_vertex[start_vertex] = true;
+    stack<NeighbourCursor> vertexes_stack;
+    vertexes_stack.push(NeighboursBegin(start_vertex));
+    while (!vertexes_stack.empty()) {
+      bool was_add = false;
+      size_t i;
+      while (NextNeighbour(vertexes_stack.top(), i)) {
+        if (!is_used_vertex[i]) {
+          current_vertexes.push_back(static_cast<VertexId>(i));
+          is_used_vertex[i] = true;
+          vertexes_stack.push(NeighboursBegin(i));
+          was_add = true;
+          break;
+        }
+      }
+      if (was_add)
+        continue;
+      vertexes_stack.pop();
+    }
+  }
+
+  // Обход графа bfs.
+  void Bfs(size_t start_vertex, vector<bool> &is_used_vertex, vector<VertexId> &current_vertexes) {
+    queue<size_t> vertexes_queue;
+    vertexes_queue.push(start_vertex);
+    while (!vertexes_queue.empty()) {
+      size_t current_vertex = vertexes_queue.front();
+      vertexes_queue.pop();
+      if (is_used_vertex[current_vertex])
+        continue;
+      current_vertexes.push_back(static_cast<VertexId>(current_vertex));
+      is_used_vertex[current_vertex] = true;
+      ForEachNeighbour(current_vertex, [&](size_t i) {
+        if (!is_used_vertex[i]) {
+          vertexes_queue.push(i);
+        }
+      });
+    }
+  }
+
+  // Обход bfs по уровням от множества начальных вершин. Заполняет расстояние в ребрах
+  // и родителя в дереве обхода для каждой вершины; для недостижимых вершин оба равны kNoVertex.
+  // Если задана вершина target, обход останавливается, как только она достигнута.
+  void BfsLevels(const vector<size_t> &sources,
+                 vector<VertexId> &distance,
+                 vector<VertexId> &parent,
+                 size_t target = numeric_limits<size_t>::max()) const {
+    distance.assign(count_of_vertexes_, kNoVertex);
+    parent.assign(count_of_vertexes_, kNoVertex);
+    ContinueBfsLevels(sources, distance, parent, target);
+  }
+
+  // Обход bfs по уровням, как в BfsLevels, но по уже заполненным массивам: вершины с расстоянием,
+  // отличным от kNoVertex, считаются посещенными. Обходы разных компонент связности не пересекаются,
+  // поэтому могут выполняться одновременно над общими массивами.
+  void ContinueBfsLevels(const vector<size_t> &sources,
+                         vector<VertexId> &distance,
+                         vector<VertexId> &parent,
+                         size_t target = numeric_limits<size_t>::max()) const {
+    vector<size_t> frontier;
+    for (size_t source : sources) {
+      if (distance[source] == 0)
+        continue;
+      distance[source] = 0;
+      frontier.push_back(source);
+    }
+    vector<size_t> next_frontier;
+    for (VertexId level = 1; !frontier.empty(); ++level) {
+      if (target < count_of_vertexes_ && distance[target] != kNoVertex)
+        break;
+      for (size_t current_vertex : frontier) {
+        ForEachNeighbour(current_vertex, [&](size_t i) {
+          if (distance[i] != kNoVertex)
+            return;
+          distance[i] = level;
+          parent[i] = static_cast<VertexId>(current_vertex);
+          next_frontier.push_back(i);
+        });
+      }
+      frontier.swap(next_frontier);
+      next_frontier.clear();
+    }
+  }
+
+  // Bit-parallel bfs одновременно из нескольких (не более 64) вершин sources.
+  // Бит i в маске вершины означает, что вершина достигнута обходом из sources[i].
+  // Для каждой вершины, впервые достигнутой на уровне level обходами из маски mask,
+  // вызывает on_visit(vertex, mask, level). seen, visit, visit_next - рабочие массивы размера
+  // count_of_vertexes_, переиспользуемые между вызовами.
+  template<typename Function>
+  void MultiSourceBfs(const vector<size_t> &sources,
+                      vector<uint64_t> &seen,
+                      vector<uint64_t> &visit,
+                      vector<uint64_t> &visit_next,
+                      Function on_visit) const {
+    fill(seen.begin(), seen.end(), 0);
+    fill(visit.begin(), visit.end(), 0);
+    fill(visit_next.begin(), visit_next.end(), 0);
+    for (size_t i = 0; i < sources.size(); ++i) {
+      seen[sources[i]] |= uint64_t{1} << i;
+      visit[sources[i]] |= uint64_t{1} << i;
+    }
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      if (visit[i])
+        on_visit(i, visit[i], size_t{0});
+    }
+    for (size_t level = 1;; ++level) {
+      for (size_t i = 0; i < count_of_vertexes_; ++i) {
+        if (!visit[i])
+          continue;
+        uint64_t mask = visit[i];
+        ForEachNeighbour(i, [&](size_t j) { visit_next[j] |= mask; });
+      }
+      bool is_active = false;
+      for (size_t i = 0; i < count_of_vertexes_; ++i) {
+        uint64_t mask = visit_next[i] & ~seen[i];
+        visit_next[i] = 0;
+        visit[i] = mask;
+        if (!mask)
+          continue;
+        is_active = true;
+        seen[i] |= mask;
+        on_visit(i, mask, level);
+      }
+      if (!is_active)
+        return;
+    }
+  }
+
+  // Находит компоненты сильной связности итеративным алгоритмом Тарьяна и возвращает их количество.
+  // Компоненты нумеруются в обратном топологическом порядке: дуги между компонентами ведут
+  // из компоненты с большим номером в компоненту с меньшим.
+  size_t StronglyConnectedComponents(vector<size_t> &component) const {
+    const size_t kUnvisited = numeric_limits<size_t>::max();
+    vector<size_t> index(count_of_vertexes_, kUnvisited);
+    vector<size_t> low(count_of_vertexes_);
+    component.assign(count_of_vertexes_, kUnvisited);
+    vector<size_t> vertexes_stack;
+    vector<pair<size_t, NeighbourCursor>> call_stack;
+    size_t count_of_components = 0;
+    size_t counter = 0;
+    for (size_t start_vertex = 0; start_vertex < count_of_vertexes_; ++start_vertex) {
+      if (index[start_vertex] != kUnvisited)
+        continue;
+      index[start_vertex] = low[start_vertex] = counter++;
+      vertexes_stack.push_back(start_vertex);
+      call_stack.emplace_back(start_vertex, NeighboursBegin(start_vertex));
+      while (!call_stack.empty()) {
+        size_t current_vertex = call_stack.back().first;
+        size_t i;
+        if (NextNeighbour(call_stack.back().second, i)) {
+          if (index[i] == kUnvisited) {
+            index[i] = low[i] = counter++;
+            vertexes_stack.push_back(i);
+            call_stack.emplace_back(i, NeighboursBegin(i));
+          } else if (component[i] == kUnvisited) {
+            low[current_vertex] = min(low[current_vertex], index[i]);
+          }
+          continue;
+        }
+        if (low[current_vertex] == index[current_vertex]) {
+          size_t vertex;
+          do {
+            vertex = vertexes_stack.back();
+            vertexes_stack.pop_back();
+            component[vertex] = count_of_components;
+          } while (vertex != current_vertex);
+          count_of_components++;
+        }
+        call_stack.pop_back();
+        if (!call_stack.empty()) {
+          size_t parent = call_stack.back().first;
+          low[parent] = min(low[parent], low[current_vertex]);
+        }
+      }
+    }
+    return count_of_components;
+  }
+
+  // Строит граф конденсации: для каждой компоненты - отсортированный список компонент,
+  // в которые из нее ведут дуги.
+  vector<vector<size_t>> Condensation(const vector<size_t> &component, size_t count_of_components) const {
+    vector<vector<size_t>> successors(count_of_components);
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      ForEachNeighbour(i, [&](size_t j) {
+        if (component[i] != component[j])
+          successors[component[i]].push_back(component[j]);
+      });
+    }
+    for (auto &list : successors) {
+      sort(list.begin(), list.end());
+      list.erase(unique(list.begin(), list.end()), list.end());
+    }
+    return successors;
+  }
+
+  // Строит транзитивное замыкание. Строка компоненты - объединение строк ее последователей,
+  // поэтому компоненты обрабатываются по уровням высоты в конденсации, а строки одного уровня
+  // считаются параллельно.
+  void BuildTransitiveClosure() {
+    size_t count_of_components = StronglyConnectedComponents(closure_component_);
+    vector<vector<size_t>> successors = Condensation(closure_component_, count_of_components);
+    closure_words_ = (count_of_components + 63) / 64;
+    closure_.assign(count_of_components * closure_words_, 0);
+    vector<size_t> height(count_of_components, 0);
+    vector<vector<size_t>> levels(1);
+    for (size_t c = 0; c < count_of_components; ++c) {
+      for (size_t d : successors[c]) {
+        height[c] = max(height[c], height[d] + 1);
+      }
+      if (height[c] >= levels.size())
+        levels.resize(height[c] + 1);
+      levels[height[c]].push_back(c);
+    }
+    for (const auto &level : levels) {
+      ParallelFor(level.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+          size_t c = level[k];
+          uint64_t *row = closure_.data() + c * closure_words_;
+          row[c / 64] |= uint64_t{1} << (c % 64);
+          for (size_t d : successors[c]) {
+            const uint64_t *successor_row = closure_.data() + d * closure_words_;
+            for (size_t w = 0; w < closure_words_; ++w) {
+              row[w] |= successor_row[w];
+            }
+          }
+        }
+      }, 64);
+    }
+    has_closure_ = true;
+  }
+
+  // Считает одну интервальную метку GRAIL для всех компонент конденсации итеративным dfs
+  // со случайным порядком корней и соседей.
+  void BuildIntervalLabel(size_t seed, vector<pair<VertexId, VertexId>> &label) const {
+    const ReachabilityIndex &index = reachability_index_;
+    size_t count_of_components = index.dag_offsets.size() - 1;
+    mt19937_64 random(seed);
+    vector<size_t> roots(count_of_components);
+    for (size_t c = 0; c < count_of_components; ++c) {
+      roots[c] = c;
+    }
+    shuffle(roots.begin(), roots.end(), random);
+    const VertexId kNoLabel = numeric_limits<VertexId>::max();
+    label.assign(count_of_components, {kNoLabel, kNoLabel});
+    // В стеке для компоненты хранится сдвиг, с которого начат перебор ее соседей, и число просмотренных соседей.
+    struct Frame {
+      size_t component;
+      size_t shift;
+      size_t count_of_passed;
+    };
+    // Компонента в стеке помечается нижней границей 0, ее метка пересчитывается при выходе.
+    vector<Frame> call_stack;
+    size_t post = 0;
+    for (size_t root : roots) {
+      if (label[root].first != kNoLabel)
+        continue;
+      label[root].first = 0;
+      call_stack.push_back({root, random(), 0});
+      while (!call_stack.empty()) {
+        Frame &frame = call_stack.back();
+        size_t begin = index.dag_offsets[frame.component];
+        size_t degree = index.dag_offsets[frame.component + 1] - begin;
+        if (frame.count_of_passed < degree) {
+          size_t next = index.dag_targets[begin + (frame.shift + frame.count_of_passed++) % degree];
+          if (label[next].first == kNoLabel) {
+            label[next].first = 0;
+            call_stack.push_back({next, random(), 0});
+          }
+          continue;
+        }
+        size_t current = frame.component;
+        call_stack.pop_back();
+        size_t low = post;
+        for (size_t k = begin; k < begin + degree; ++k) {
+          low = min(low, static_cast<size_t>(label[index.dag_targets[k]].first));
+        }
+        label[current] = {static_cast<VertexId>(low), static_cast<VertexId>(post++)};
+      }
+    }
+  }
+
+  // Строит индекс достижимости: конденсацию и kCountOfLabels интервальных меток, считаемых параллельно.
+  void BuildReachabilityIndex() {
+    ReachabilityIndex &index = reachability_index_;
+    vector<size_t> component;
+    size_t count_of_components = StronglyConnectedComponents(component);
+    vector<vector<size_t>> successors = Condensation(component, count_of_components);
+    index.component.assign(component.begin(), component.end());
+    index.dag_offsets.assign(count_of_components + 1, 0);
+    index.dag_targets.clear();
+    for (size_t c = 0; c < count_of_components; ++c) {
+      index.dag_targets.insert(index.dag_targets.end(), successors[c].begin(), successors[c].end());
+      index.dag_offsets[c + 1] = static_cast<EdgeIndex>(index.dag_targets.size());
+    }
+    vector<vector<pair<VertexId, VertexId>>> labels(kCountOfLabels);
+    ParallelFor(kCountOfLabels, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        BuildIntervalLabel(i + 1, labels[i]);
+      }
+    }, 1);
+    index.labels.resize(count_of_components * kCountOfLabels);
+    for (size_t c = 0; c < count_of_components; ++c) {
+      for (size_t i = 0; i < kCountOfLabels; ++i) {
+        index.labels[c * kCountOfLabels + i] = labels[i][c];
+      }
+    }
+    has_reachability_index_ = true;
+  }
+
+  // Проверяет, что по меткам компонента to может быть достижима из компоненты from.
+  bool IsLabelContained(size_t from, size_t to) const {
+    const auto *from_labels = reachability_index_.labels.data() + from * kCountOfLabels;
+    const auto *to_labels = reachability_index_.labels.data() + to * kCountOfLabels;
+    for (size_t i = 0; i < kCountOfLabels; ++i) {
+      if (to_labels[i].first < from_labels[i].first || to_labels[i].second > from_labels[i].second)
+        return false;
+    }
+    return true;
+  }
+
+  // Контрольная сумма FNV-1a по смещениям и спискам соседей. Сохраняется вместе с индексом
+  // достижимости, чтобы индекс другого графа с теми же размерами не был принят при загрузке.
+  uint64_t AdjacencyChecksum() const {
+    uint64_t checksum = 14695981039346656037ull;
+    auto mix = [&checksum](uint64_t value) {
+      checksum ^= value;
+      checksum *= 1099511628211ull;
+    };
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      mix(OutDegree(i));
+      ForEachNeighbour(i, [&](size_t neighbour) { mix(neighbour); });
+    }
+    return checksum;
+  }
+
+  // Вывод графа в виде матрицы смежности в поток. Строки матрицы форматируются параллельно.
+  void StreamPrintAdjacencyMatrix(ostream &out) {
+    FormatRowsInOrder(out, count_of_vertexes_ + 1, 2 * count_of_vertexes_ + 8, [&](size_t row, string &buffer) {
+      if (row == 0) {
+        buffer += '\t';
+        for (size_t i = 0; i < count_of_vertexes_; ++i) {
+          AppendNumber(buffer, i + 1);
+          buffer += '\t';
+        }
+        buffer += '\n';
+        return;
+      }
+      size_t i = row - 1;
+      AppendNumber(buffer, i + 1);
+      buffer += '\t';
+      NeighbourCursor cursor = NeighboursBegin(i);
+      size_t next;
+      bool has_next = NextNeighbour(cursor, next);
+      for (size_t j = 0; j < count_of_vertexes_; ++j) {
+        Weight value = 0;
+        if (has_next && next == j) {
+          value = cursor.weight;
+          has_next = NextNeighbour(cursor, next);
+        }
+        AppendNumber(buffer, value);
+        buffer += '\t';
+      }
+      buffer += '\n';
+    });
+  }
+
+  // Консольный вывод графа в виде матрицы смежности.
+  void ConsolePrintAdjacencyMatrix() {
+    StreamPrintAdjacencyMatrix(cout);
+  }
+
+  // Файловый вывод графа в виде матрицы смежности.
+  void FilePrintAdjacencyMatrix() {
+    AsyncFileStream out(output_path_);
+    if (!out.IsOpen()) {
+      cerr << "Ошибка вывода!" << endl;
+      return;
+    }
+    StreamPrintAdjacencyMatrix(out);
+  }
+
+  // Консольный вывод графа в виде списка смежности.
+  void ConsolePrintAdjacencyList() {
+    const vector<vector<VertexId>> &adjacency_list = GetAdjacencyList();
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      cout << i + 1 << " | ";
+      for (size_t v : adjacency_list[i]) {
+        cout << v + 1 << " ";
+      }
+      cout << endl;
+    }
+  }
+
+  // Файловый вывод графа в виде списка смежности.
+  void FilePrintAdjacencyList() {
+    AsyncFileStream out(output_path_);
+    if (!out.IsOpen()) {
+      cerr << "Ошибка вывода!" << endl;
+      return;
+    }
+    const vector<vector<VertexId>> &adjacency_list = GetAdjacencyList();
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      out << i + 1 << " | ";
+      for (size_t v : adjacency_list[i]) {
+        out << v + 1 << " ";
+      }
+      out << endl;
+    }
+  }
+
+  // Консольный вывод списка ребер; weights - веса ребер, которые выводятся во взвешенном графе.
+  void ConsolePrintListOfEdges(const vector<pair<VertexId, VertexId>> &list_of_edges, const vector<Weight> &weights) {
+    for (size_t i = 0; i < list_of_edges.size(); ++i) {
+      cout << list_of_edges[i].first << " " << list_of_edges[i].second;
+      if (is_weighted_)
+        cout << " " << weights[i];
+      cout << endl;
+    }
+  }
+
+  // Файловый вывод списка ребер; weights - веса ребер, которые выводятся во взвешенном графе.
+  void FilePrintListOfEdges(const vector<pair<VertexId, VertexId>> &list_of_edges, const vector<Weight> &weights) {
+    AsyncFileStream out(output_path_);
+    if (!out.IsOpen()) {
+      cerr << "Ошибка вывода!" << endl;
+      return;
+    }
+    for (size_t i = 0; i < list_of_edges.size(); ++i) {
+      out << list_of_edges[i].first << " " << list_of_edges[i].second;
+      if (is_weighted_)
+        out << " " << weights[i];
+      out << endl;
+    }
+  }
+
+  // Вывод графа в виде матрицы инцидентности в поток. Строки матрицы форматируются параллельно.
+  void StreamPrintIncidenceMatrix(ostream &out) {
+    const vector<vector<int>> &incidence_matrix = GetIncidenceMatrix();
+    FormatRowsInOrder(out, count_of_vertexes_ + 1, 2 * count_of_edges_ + 8, [&](size_t row, string &buffer) {
+      if (row == 0) {
+        buffer += '\t';
+        for (size_t i = 0; i < count_of_edges_; ++i) {
+          AppendNumber(buffer, i + 1);
+          buffer += '\t';
+        }
+        buffer += '\n';
+        return;
+      }
+      size_t i = row - 1;
+      AppendNumber(buffer, i + 1);
+      buffer += '\t';
+      for (size_t j = 0; j < count_of_edges_; ++j) {
+        AppendNumber(buffer, incidence_matrix[i][j]);
+        buffer += '\t';
+      }
+      buffer += '\n';
+    });
+  }
+
+  // Консольный вывод графа в виде матрицы инцидентности.
+  void ConsolePrintIncidenceMatrix() {
+    StreamPrintIncidenceMatrix(cout);
+  }
+
+  // Файловый вывод графа в виде матрицы инцидентности.
+  void FilePrintIncidenceMatrix() {
+    AsyncFileStream out(output_path_);
+    if (!out.IsOpen()) {
+      cerr << "Ошибка вывода!" << endl;
+      return;
+    }
+    StreamPrintIncidenceMatrix(out);
+  }
+
+ public:
+  // Пустой конструктор класса. Просто инициализирует поля дефолтными значениями.
+  Graph() {
+    count_of_vertexes_ = 0;
+    count_of_edges_ = 0;
+    is_orient_ = false;
+    is_weighted_ = false;
+    is_compressed_ = false;
+    count_of_compressed_arcs_ = 0;
+    has_closure_ = false;
+    closure_words_ = 0;
+    has_reachability_index_ = false;
+    offsets_.assign(1, 0);
+    output_path_ = "..";
+    output_path_ += filesystem::path::preferred_separator;
+    output_path_ += "output.txt";
+    input_path_ = "..";
+    input_path_ += filesystem::path::preferred_separator;
+    input_path_ += "input.txt";
+    index_path_ = "..";
+    index_path_ += filesystem::path::preferred_separator;
+    index_path_ += "reachability.idx";
+  }
+
+  // Конструтор класса с параметрами. Инициализирует поля, согласно входным параметрам.
+  // arcs - дуги графа; в неориентированном графе каждое ребро задается дугами в обе стороны.
+  // arc_weights - веса дуг в том же порядке или пустой вектор для невзвешенного графа.
+  Graph(size_t count_of_vertexes,
+        size_t count_of_edges,
+        const vector<Arc> &arcs,
+        const vector<Weight> &arc_weights,
+        bool is_orient) {
+    count_of_vertexes_ = count_of_vertexes;
+    count_of_edges_ = count_of_edges;
+    is_orient_ = is_orient;
+    is_weighted_ = false;
+    is_compressed_ = false;
+    count_of_compressed_arcs_ = 0;
+    has_closure_ = false;
+    closure_words_ = 0;
+    has_reachability_index_ = false;
+    BuildNeighbours(arcs, arc_weights);
+    output_path_ = "..";
+    output_path_ += filesystem::path::preferred_separator;
+    output_path_ += "output.txt";
+    input_path_ = "..";
+    input_path_ += filesystem::path::preferred_separator;
+    input_path_ += "input.txt";
+    index_path_ = "..";
+    index_path_ += filesystem::path::preferred_separator;
+    index_path_ += "reachability.idx";
+  }
+
+  // Конструктор графа со сжатыми списками соседей lists (см. CompressedLists).
+  Graph(size_t count_of_vertexes, size_t count_of_edges, CompressedLists &&lists, bool is_orient)
+      : Graph() {
+    count_of_vertexes_ = count_of_vertexes;
+    count_of_edges_ = count_of_edges;
+    is_orient_ = is_orient;
+    UseCompressedLists(move(lists));
+  }
+
+  // Вывод графа в виде матрицы смежности, предоставляя выбор способа вывода.
+  void PrintAdjacencyMatrix() {
+    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
+         << "чтобы вывести в файл." << endl << "> ";
+    string output_type;
+    cin >> output_type;
+    if (output_type[0] == '0') {
+      ConsolePrintAdjacencyMatrix();
+      return;
+    }
+    FilePrintAdjacencyMatrix();
+  }
+
+  // Вывод графа в виде списка смежности, предоставляя выбор способа вывода.
+  void PrintAdjacencyList() {
+    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
+         << "чтобы вывести в файл." << endl << "> ";
+    string output_type;
+    cin >> output_type;
+    if (output_type[0] == '0') {
+      ConsolePrintAdjacencyList();
+      return;
+    }
+    FilePrintAdjacencyList();
+  }
+
+  // Вывод списка ребер, предоставляя выбор способа вывода.
+  void PrintListOfEdges(const vector<pair<VertexId, VertexId>> &list_of_edges, const vector<Weight> &weights) {
+    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
+         << "чтобы вывести в файл." << endl << "> ";
+    string output_type;
+    cin >> output_type;
+    if (output_type[0] == '0') {
+      ConsolePrintListOfEdges(list_of_edges, weights);
+      return;
+    }
+    FilePrintListOfEdges(list_of_edges, weights);
+  }
+
+  // Вывод графа в виде списка ребер, предоставляя выбор способа вывода.
+  void PrintListOfEdges() {
+    const vector<pair<VertexId, VertexId>> &list_of_edges = GetListOfEdges();
+    PrintListOfEdges(list_of_edges, GetEdgeWeights());
+  }
+
+  // Вывод графа в виде матрицы инцидентности, предоставляя выбор способа вывода.
+  void PrintIncidenceMatrix() {
+    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
+         << "чтобы вывести в файл." << endl << "> ";
+    string output_type;
+    cin >> output_type;
+    if (output_type[0] == '0') {
+      ConsolePrintIncidenceMatrix();
+      return;
+    }
+    FilePrintIncidenceMatrix();
+  }
+
+  // Реализовывает обход графа, предоставляя выбор способа обхода.
+  // Строки с вершинами каждой компоненты форматируются параллельно.
+  void GraphTravelsale(int type_of_travelsale) {
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<bool> is_used_vertex(count_of_vertexes_, false);
+    int current_component = 0;
+    for (size_t i = 0; i < count_of_vertexes_; ++i)
       if (!is_used_vertex[i]) {
+        out << current_component + 1 << "-ая компонента:" << endl;
+        vector<VertexId> vertexes;
+        switch (type_of_travelsale) {
+          case 0:RecursionDfs(is_used_vertex, i, vertexes);
+            break;
+          case 1:StackDfs(is_used_vertex, i, vertexes);
+            break;
+          case 2:Bfs(i, is_used_vertex, vertexes);
+            break;
+          default:break;
+        }
+        current_component++;
+        FormatRowsInOrder(out, vertexes.size(), 20, [&](size_t row, string &buffer) {
+          buffer += "Вершина #";
+          AppendNumber(buffer, static_cast<size_t>(vertexes[row]) + 1);
+          buffer += '\n';
+        });
+        out << "-------------------------" << endl;
+      }
+  }
+
+  // Находит и выводит степень каждой вершины графа.
+  void PrintVertexDegree() {
+    AsyncFileStream fout;
+    bool is_console = true;
+    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
+         << "чтобы вывести в файл." << endl << "> ";
+    string output_type;
+    cin >> output_type;
+    if (output_type[0] != '0') {
+      fout.Open(output_path_);
+      is_console = false;
+    }
+    const vector<EdgeIndex> &in_degree = InDegrees();
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      if (is_console)
+        cout << i + 1 << " : ";
+      else
+        fout << i + 1 << " : ";
+      size_t cnt_out = OutDegree(i);
+      size_t cnt_in = in_degree[i];
+      if (is_orient_)
         if (is_console)
-          cout << current_component + 1 << "-ая компонента:" << endl;
+          cout << "Исходящих = " << cnt_out << ", Входящих = " << cnt_in << endl;
         else
-          fout << current_component + 1 << "-ая компонента:" << endl;
-        vector<int> vertexes;
-        switch (type_of_travelsale) {
-          case 0:RecursionDfs(is_used_vertex, i, vertexes);
-            break;
-          case 1:StackDfs(is_used_vertex, i, vertexes);
+          fout << "Исходящих = " << cnt_out << ", Входящих = " << cnt_in << endl;
+      else if (is_console)
+        cout << "Степень = " << (cnt_out + cnt_in) / 2 << endl;
+      else
+        fout << "Степень = " << (cnt_out + cnt_in) / 2 << endl;
+    }
+  }
+
+  // Количество вершин графа.
+  size_t CountOfVertexes() const {
+    return count_of_vertexes_;
+  }
+
+  // Ориентирован ли граф.
+  bool IsOrient() const {
+    return is_orient_;
+  }
+
+  // Количество дуг, выходящих из вершины.
+  size_t OutDegree(size_t vertex) const {
+    if (!is_compressed_)
+      return offsets_[vertex + 1] - offsets_[vertex];
+    size_t byte = compressed_offsets_[vertex];
+    return DecodeVarint(compressed_neighbours_, byte);
+  }
+
+  // Количество входящих дуг у каждой вершины, считается при первом обращении
+  // по смещениям обратных списков соседей.
+  const vector<EdgeIndex> &InDegrees() {
+    if (views_.has_in_degrees)
+      return views_.in_degree;
+    if (!views_.has_reverse_neighbours)
+      BuildReverseNeighbours();
+    const vector<EdgeIndex> &reverse_offsets = views_.reverse_offsets;
+    vector<EdgeIndex> in_degree(count_of_vertexes_);
+    ParallelFor(count_of_vertexes_, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        in_degree[i] = reverse_offsets[i + 1] - reverse_offsets[i];
+      }
+    });
+    views_.in_degree = move(in_degree);
+    views_.has_in_degrees = true;
+    return views_.in_degree;
+  }
+
+  // Количество дуг, входящих в вершину. Требует посчитанных входящих степеней.
+  size_t InDegree(size_t vertex) const {
+    return views_.in_degree[vertex];
+  }
+
+  // Возвращает соседей вершины по возрастанию номеров.
+  vector<size_t> GetNeighbours(size_t vertex) const {
+    vector<size_t> neighbours;
+    neighbours.reserve(OutDegree(vertex));
+    ForEachNeighbour(vertex, [&](size_t i) { neighbours.push_back(i); });
+    return neighbours;
+  }
+
+  // Строит все, что нужно для запросов без изменения графа: после этого запросы
+  // IsReachableInIndex, ComponentOf и InDegree можно выполнять из нескольких потоков одновременно.
+  void PrepareQueries() {
+    if (!has_reachability_index_)
+      BuildReachabilityIndex();
+    InDegrees();
+  }
+
+  // Номер компоненты сильной связности вершины (в неориентированном графе - компоненты связности).
+  // Требует построенного индекса достижимости.
+  size_t ComponentOf(size_t vertex) const {
+    return reachability_index_.component[vertex];
+  }
+
+  // Номер несуществующей вершины и расстояние до недостижимой вершины при обходе bfs.
+  static constexpr VertexId kNoVertex = numeric_limits<VertexId>::max();
+
+  // Тип номера вершины.
+  using VertexType = VertexId;
+
+  // Находит расстояния в ребрах от ближайшей из вершин sources и родителей в дереве bfs.
+  void BfsDistances(const vector<size_t> &sources, vector<VertexId> &distance, vector<VertexId> &parent) const {
+    BfsLevels(sources, distance, parent);
+  }
+
+  // Находит путь с наименьшим числом ребер из вершины from в вершину to.
+  // Возвращает пустой вектор, если пути нет.
+  vector<size_t> FindPath(size_t from, size_t to) const {
+    vector<VertexId> distance;
+    vector<VertexId> parent;
+    BfsLevels({from}, distance, parent, to);
+    vector<size_t> path;
+    if (distance[to] == kNoVertex)
+      return path;
+    for (size_t vertex = to; vertex != from; vertex = parent[vertex]) {
+      path.push_back(vertex);
+    }
+    path.push_back(from);
+    reverse(path.begin(), path.end());
+    return path;
+  }
+
+  // Находит расстояние в ребрах от вершины from до вершины to или kNoVertex, если to недостижима.
+  // Посещенные вершины отмечаются номером запроса в массиве своего потока, который не очищается
+  // между запросами, поэтому короткий запрос не тратит время на весь граф.
+  VertexId BfsDistance(size_t from, size_t to) const {
+    thread_local vector<size_t> visited;
+    thread_local size_t query = 0;
+    if (visited.size() < count_of_vertexes_)
+      visited.resize(count_of_vertexes_, 0);
+    ++query;
+    vector<size_t> frontier = {from};
+    vector<size_t> next_frontier;
+    visited[from] = query;
+    for (VertexId level = 0; !frontier.empty(); ++level) {
+      for (size_t current_vertex : frontier) {
+        if (current_vertex == to)
+          return level;
+        ForEachNeighbour(current_vertex, [&](size_t i) {
+          if (visited[i] == query)
+            return;
+          visited[i] = query;
+          next_frontier.push_back(i);
+        });
+      }
+      frontier.swap(next_frontier);
+      next_frontier.clear();
+    }
+    return kNoVertex;
+  }
+
+  // Выводит расстояния в ребрах и родителей в дереве bfs от одной или нескольких вершин.
+  void PrintBfsDistances() {
+    cout << "Введите количество начальных вершин." << endl << "> ";
+    size_t count_of_sources = 0;
+    cin >> count_of_sources;
+    if (!cin || count_of_sources == 0 || count_of_sources > count_of_vertexes_) {
+      cin.clear();
+      cerr << "Неверное количество вершин!" << endl;
+      return;
+    }
+    vector<size_t> sources(count_of_sources);
+    for (size_t &source : sources) {
+      if (!ReadVertex("Введите номер начальной вершины.", source))
+        return;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<VertexId> distance;
+    vector<VertexId> parent;
+    BfsDistances(sources, distance, parent);
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      out << i + 1 << " : ";
+      if (distance[i] == kNoVertex) {
+        out << "недостижима" << endl;
+        continue;
+      }
+      out << "расстояние = " << static_cast<size_t>(distance[i]);
+      if (parent[i] != kNoVertex)
+        out << ", родитель = " << static_cast<size_t>(parent[i]) + 1;
+      out << endl;
+    }
+  }
+
+  // Выводит путь с наименьшим числом ребер между двумя вершинами.
+  void PrintPath() {
+    size_t from;
+    size_t to;
+    if (!ReadVertex("Введите номер начальной вершины.", from) || !ReadVertex("Введите номер конечной вершины.", to))
+      return;
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<size_t> path = FindPath(from, to);
+    if (path.empty()) {
+      out << "Пути нет" << endl;
+      return;
+    }
+    out << "Длина пути = " << path.size() - 1 << endl;
+    for (size_t vertex : path) {
+      out << vertex + 1 << " ";
+    }
+    out << endl;
+  }
+
+  // Находит эксцентриситет каждой вершины: наибольшее расстояние в ребрах до достижимых из нее вершин.
+  // Обходы запускаются пачками по 64 вершины, пачки обрабатываются параллельно.
+  vector<size_t> Eccentricities() const {
+    const size_t kBatch = 64;
+    vector<size_t> eccentricity(count_of_vertexes_, 0);
+    size_t count_of_batches = (count_of_vertexes_ + kBatch - 1) / kBatch;
+    ParallelFor(count_of_batches, [&](size_t begin, size_t end) {
+      vector<uint64_t> seen(count_of_vertexes_);
+      vector<uint64_t> visit(count_of_vertexes_);
+      vector<uint64_t> visit_next(count_of_vertexes_);
+      for (size_t batch = begin; batch < end; ++batch) {
+        vector<size_t> sources;
+        for (size_t i = batch * kBatch; i < min(count_of_vertexes_, (batch + 1) * kBatch); ++i) {
+          sources.push_back(i);
+        }
+        MultiSourceBfs(sources, seen, visit, visit_next, [&](size_t, uint64_t mask, size_t level) {
+          for (; mask; mask &= mask - 1) {
+            eccentricity[sources[countr_zero(mask)]] = level;
+          }
+        });
+      }
+    }, 1);
+    return eccentricity;
+  }
+
+  // Выводит эксцентриситеты вершин, радиус и диаметр графа.
+  void PrintEccentricities() {
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<size_t> eccentricity = Eccentricities();
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      out << i + 1 << " : " << eccentricity[i] << endl;
+    }
+    if (count_of_vertexes_ == 0)
+      return;
+    out << "Радиус = " << *min_element(eccentricity.begin(), eccentricity.end()) << endl;
+    out << "Диаметр = " << *max_element(eccentricity.begin(), eccentricity.end()) << endl;
+  }
+
+  // Выводит матрицу расстояний в ребрах между всеми парами вершин; "-" означает, что пути нет.
+  // Строки матрицы считаются пачками по 64 bit-parallel обходом bfs.
+  void PrintDistanceMatrix() {
+    const size_t kBatch = 64;
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    out << "\t";
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      out << i + 1 << "\t";
+    }
+    out << endl;
+    vector<uint64_t> seen(count_of_vertexes_);
+    vector<uint64_t> visit(count_of_vertexes_);
+    vector<uint64_t> visit_next(count_of_vertexes_);
+    vector<VertexId> rows;
+    for (size_t first = 0; first < count_of_vertexes_; first += kBatch) {
+      vector<size_t> sources;
+      for (size_t i = first; i < min(count_of_vertexes_, first + kBatch); ++i) {
+        sources.push_back(i);
+      }
+      rows.assign(sources.size() * count_of_vertexes_, kNoVertex);
+      MultiSourceBfs(sources, seen, visit, visit_next, [&](size_t vertex, uint64_t mask, size_t level) {
+        for (; mask; mask &= mask - 1) {
+          rows[countr_zero(mask) * count_of_vertexes_ + vertex] = static_cast<VertexId>(level);
+        }
+      });
+      for (size_t k = 0; k < sources.size(); ++k) {
+        out << sources[k] + 1 << "\t";
+        for (size_t j = 0; j < count_of_vertexes_; ++j) {
+          VertexId distance = rows[k * count_of_vertexes_ + j];
+          if (distance == kNoVertex)
+            out << "-\t";
+          else
+            out << static_cast<size_t>(distance) << "\t";
+        }
+        out << endl;
+      }
+    }
+  }
+
+  // Проверяет, достижима ли вершина to из вершины from, по транзитивному замыканию.
+  bool IsReachable(size_t from, size_t to) {
+    if (!has_closure_)
+      BuildTransitiveClosure();
+    size_t to_component = closure_component_[to];
+    return closure_[closure_component_[from] * closure_words_ + to_component / 64] >> (to_component % 64) & 1;
+  }
+
+  // Отвечает, достижима ли одна вершина из другой.
+  void PrintReachability() {
+    size_t from;
+    size_t to;
+    if (!ReadVertex("Введите номер начальной вершины.", from) || !ReadVertex("Введите номер конечной вершины.", to))
+      return;
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    if (IsReachable(from, to))
+      out << "Вершина " << to + 1 << " достижима из вершины " << from + 1 << endl;
+    else
+      out << "Вершина " << to + 1 << " недостижима из вершины " << from + 1 << endl;
+  }
+
+  // Проверяет достижимость вершины to из вершины from по индексу GRAIL.
+  // Индекс строится при первом запросе, если не был построен или загружен заранее.
+  bool IsReachableByIndex(size_t from, size_t to) {
+    if (!has_reachability_index_)
+      BuildReachabilityIndex();
+    return IsReachableInIndex(from, to);
+  }
+
+  // Проверяет достижимость вершины to из вершины from по уже построенному индексу GRAIL.
+  // Не меняет граф, поэтому может вызываться из нескольких потоков одновременно.
+  bool IsReachableInIndex(size_t from, size_t to) const {
+    const ReachabilityIndex &index = reachability_index_;
+    size_t from_component = index.component[from];
+    size_t to_component = index.component[to];
+    if (from_component == to_component)
+      return true;
+    if (!IsLabelContained(from_component, to_component))
+      return false;
+    // Метки не дали ответа: dfs по конденсации, заходящий только в компоненты, метки которых
+    // содержат метки искомой. Посещенные компоненты отмечаются номером запроса.
+    thread_local vector<size_t> visited;
+    thread_local size_t query = 0;
+    size_t count_of_components = index.dag_offsets.size() - 1;
+    if (visited.size() < count_of_components)
+      visited.resize(count_of_components, 0);
+    ++query;
+    vector<size_t> components_stack = {from_component};
+    visited[from_component] = query;
+    while (!components_stack.empty()) {
+      size_t current = components_stack.back();
+      components_stack.pop_back();
+      for (EdgeIndex k = index.dag_offsets[current]; k < index.dag_offsets[current + 1]; ++k) {
+        size_t next = index.dag_targets[k];
+        if (next == to_component)
+          return true;
+        if (visited[next] == query || !IsLabelContained(next, to_component))
+          continue;
+        visited[next] = query;
+        components_stack.push_back(next);
+      }
+    }
+    return false;
+  }
+
+  // Сохраняет индекс достижимости в двоичный файл рядом с графом. Возвращает false при ошибке записи.
+  bool SaveReachabilityIndex() {
+    if (!has_reachability_index_)
+      BuildReachabilityIndex();
+    ofstream out(index_path_, ios::binary);
+    if (!out.is_open())
+      return false;
+    const ReachabilityIndex &index = reachability_index_;
+    auto write_array = [&](const auto &array) {
+      uint64_t size = array.size();
+      out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+      out.write(reinterpret_cast<const char *>(array.data()),
+                static_cast<streamsize>(array.size() * sizeof(array[0])));
+    };
+    uint64_t header[] = {count_of_vertexes_, CountOfArcs(), kCountOfLabels,
+                         sizeof(VertexId), sizeof(EdgeIndex), AdjacencyChecksum()};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    write_array(index.component);
+    write_array(index.dag_offsets);
+    write_array(index.dag_targets);
+    write_array(index.labels);
+    return static_cast<bool>(out);
+  }
+
+  // Загружает индекс достижимости из файла. Возвращает false, если файла нет, он поврежден
+  // или построен для другого графа.
+  bool LoadReachabilityIndex() {
+    ifstream in(index_path_, ios::binary);
+    if (!in.is_open())
+      return false;
+    ReachabilityIndex index;
+    auto read_array = [&](auto &array) {
+      uint64_t size = 0;
+      in.read(reinterpret_cast<char *>(&size), sizeof(size));
+      if (!in || size > numeric_limits<size_t>::max() / sizeof(array[0]))
+        return false;
+      array.resize(size);
+      in.read(reinterpret_cast<char *>(array.data()), static_cast<streamsize>(size * sizeof(array[0])));
+      return static_cast<bool>(in);
+    };
+    uint64_t header[6];
+    in.read(reinterpret_cast<char *>(header), sizeof(header));
+    uint64_t expected[] = {count_of_vertexes_, CountOfArcs(), kCountOfLabels,
+                           sizeof(VertexId), sizeof(EdgeIndex), AdjacencyChecksum()};
+    if (!in || !equal(begin(header), end(header), begin(expected)))
+      return false;
+    if (!read_array(index.component) || !read_array(index.dag_offsets) || !read_array(index.dag_targets)
+        || !read_array(index.labels))
+      return false;
+    if (index.dag_offsets.empty() || index.dag_offsets.back() != index.dag_targets.size())
+      return false;
+    size_t count_of_components = index.dag_offsets.size() - 1;
+    if (index.component.size() != count_of_vertexes_ || index.labels.size() != count_of_components * kCountOfLabels)
+      return false;
+    // Запросы обращаются к массивам без проверок, поэтому все номера и смещения проверяются здесь.
+    if (!is_sorted(index.dag_offsets.begin(), index.dag_offsets.end()))
+      return false;
+    auto is_component = [count_of_components](VertexId c) { return static_cast<size_t>(c) < count_of_components; };
+    if (!all_of(index.component.begin(), index.component.end(), is_component)
+        || !all_of(index.dag_targets.begin(), index.dag_targets.end(), is_component))
+      return false;
+    reachability_index_ = move(index);
+    has_reachability_index_ = true;
+    return true;
+  }
+
+  // Отвечает, достижима ли одна вершина из другой, по индексу достижимости.
+  void PrintReachabilityByIndex() {
+    size_t from;
+    size_t to;
+    if (!ReadVertex("Введите номер начальной вершины.", from) || !ReadVertex("Введите номер конечной вершины.", to))
+      return;
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    if (IsReachableByIndex(from, to))
+      out << "Вершина " << to + 1 << " достижима из вершины " << from + 1 << endl;
+    else
+      out << "Вершина " << to + 1 << " недостижима из вершины " << from + 1 << endl;
+  }
+
+  // Считает треугольники неориентированного графа и число треугольников при каждой вершине.
+  // Ребра ориентируются от вершины меньшей степени к большей, после чего каждый треугольник
+  // находится ровно один раз пересечением отсортированных исходящих списков его концов.
+  uint64_t CountTriangles(vector<uint64_t> &vertex_triangles) const {
+    auto is_before = [&](size_t u, size_t v) {
+      size_t u_degree = OutDegree(u);
+      size_t v_degree = OutDegree(v);
+      return u_degree < v_degree || (u_degree == v_degree && u < v);
+    };
+    vector<EdgeIndex> forward_offsets(count_of_vertexes_ + 1, 0);
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      size_t count_of_forward = 0;
+      ForEachNeighbour(i, [&](size_t j) { count_of_forward += is_before(i, j); });
+      forward_offsets[i + 1] = static_cast<EdgeIndex>(forward_offsets[i] + count_of_forward);
+    }
+    vector<VertexId> forward(forward_offsets[count_of_vertexes_]);
+    ParallelFor(count_of_vertexes_, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        EdgeIndex k = forward_offsets[i];
+        ForEachNeighbour(i, [&](size_t j) {
+          if (is_before(i, j))
+            forward[k++] = static_cast<VertexId>(j);
+        });
+      }
+    });
+    vector<atomic<uint64_t>> triangles(count_of_vertexes_);
+    atomic<uint64_t> count_of_triangles = 0;
+    ParallelForDynamic(count_of_vertexes_, [&](size_t begin, size_t end) {
+      uint64_t local_count = 0;
+      for (size_t u = begin; u < end; ++u) {
+        for (EdgeIndex k = forward_offsets[u]; k < forward_offsets[u + 1]; ++k) {
+          size_t v = forward[k];
+          EdgeIndex a = forward_offsets[u];
+          EdgeIndex b = forward_offsets[v];
+          while (a < forward_offsets[u + 1] && b < forward_offsets[v + 1]) {
+            if (forward[a] < forward[b]) {
+              ++a;
+            } else if (forward[b] < forward[a]) {
+              ++b;
+            } else {
+              triangles[u].fetch_add(1, memory_order_relaxed);
+              triangles[v].fetch_add(1, memory_order_relaxed);
+              triangles[forward[a]].fetch_add(1, memory_order_relaxed);
+              ++local_count;
+              ++a;
+              ++b;
+            }
+          }
+        }
+      }
+      count_of_triangles.fetch_add(local_count, memory_order_relaxed);
+    }, 64);
+    vertex_triangles.resize(count_of_vertexes_);
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      vertex_triangles[i] = triangles[i].load(memory_order_relaxed);
+    }
+    return count_of_triangles;
+  }
+
+  // Выводит число треугольников и локальные коэффициенты кластеризации вершин.
+  void PrintTriangles() {
+    if (is_orient_) {
+      cerr << "Треугольники считаются только в неориентированном графе!" << endl;
+      return;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<uint64_t> vertex_triangles;
+    uint64_t count_of_triangles = CountTriangles(vertex_triangles);
+    out << "Количество треугольников = " << count_of_triangles << endl;
+    double sum_of_coefficients = 0;
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      double degree = static_cast<double>(OutDegree(i));
+      double coefficient = degree < 2 ? 0 : 2.0 * static_cast<double>(vertex_triangles[i]) / (degree * (degree - 1));
+      sum_of_coefficients += coefficient;
+      out << i + 1 << " : треугольников = " << vertex_triangles[i] << ", коэффициент кластеризации = "
+          << coefficient << endl;
+    }
+    if (count_of_vertexes_ > 0)
+      out << "Средний коэффициент кластеризации = " << sum_of_coefficients / static_cast<double>(count_of_vertexes_)
+          << endl;
+  }
+
+  // Считает PageRank степенным методом. Real - тип вычислений (float вдвое уменьшает объем читаемой памяти).
+  // В режиме pull каждая вершина собирает вклады по обратным дугам (их списки строятся один раз и хранятся
+  // в графе), в режиме push вершины рассылают свой вклад по исходящим дугам с атомарным сложением.
+  // Ранг висячих вершин делится поровну между всеми.
+  // Итерации прекращаются, когда сумма изменений рангов меньше tolerance, но их не больше max_iterations.
+  template<typename Real>
+  vector<Real> PageRank(bool is_push, Real damping, Real tolerance, size_t max_iterations, size_t &iterations) {
+    size_t n = count_of_vertexes_;
+    iterations = 0;
+    if (n == 0)
+      return {};
+    vector<Real> rank(n, Real(1) / static_cast<Real>(n));
+    vector<Real> contribution(n);
+    if (!is_push && !views_.has_reverse_neighbours)
+      BuildReverseNeighbours();
+    const vector<EdgeIndex> &reverse_offsets = views_.reverse_offsets;
+    const vector<VertexId> &reverse_neighbours = views_.reverse_neighbours;
+    vector<atomic<Real>> pushed(is_push ? n : 0);
+    while (iterations < max_iterations) {
+      ++iterations;
+      Real dangling = 0;
+      for (size_t i = 0; i < n; ++i) {
+        size_t out_degree = OutDegree(i);
+        if (out_degree == 0)
+          dangling += rank[i];
+        contribution[i] = out_degree == 0 ? Real(0) : rank[i] / static_cast<Real>(out_degree);
+      }
+      Real base = (Real(1) - damping + damping * dangling) / static_cast<Real>(n);
+      if (is_push) {
+        for (auto &value : pushed) {
+          value.store(0, memory_order_relaxed);
+        }
+        ParallelFor(n, [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            ForEachNeighbour(i, [&](size_t j) { pushed[j].fetch_add(contribution[i], memory_order_relaxed); });
+          }
+        });
+      }
+      mutex difference_mutex;
+      Real difference = 0;
+      ParallelFor(n, [&](size_t begin, size_t end) {
+        Real local_difference = 0;
+        for (size_t i = begin; i < end; ++i) {
+          Real sum = 0;
+          if (is_push) {
+            sum = pushed[i].load(memory_order_relaxed);
+          } else {
+            for (EdgeIndex k = reverse_offsets[i]; k < reverse_offsets[i + 1]; ++k) {
+              sum += contribution[reverse_neighbours[k]];
+            }
+          }
+          Real new_rank = base + damping * sum;
+          local_difference += abs(new_rank - rank[i]);
+          rank[i] = new_rank;
+        }
+        lock_guard<mutex> lock(difference_mutex);
+        difference += local_difference;
+      });
+      if (difference < tolerance)
+        break;
+    }
+    return rank;
+  }
+
+  // Выводит PageRank вершин. is_push - выбор режима push вместо pull.
+  void PrintPageRank(bool is_push) {
+    cout << "Введите коэффициент затухания и точность через пробел (например, 0.85 1e-9)." << endl << "> ";
+    double damping = 0.85;
+    double tolerance = 1e-9;
+    cin >> damping >> tolerance;
+    if (!cin || damping < 0 || damping > 1 || tolerance <= 0) {
+      cin.clear();
+      cerr << "Неверные параметры!" << endl;
+      return;
+    }
+    cout << "Введите 0, чтобы считать в double, и любое другое число, чтобы считать в float." << endl << "> ";
+    string precision;
+    cin >> precision;
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    const size_t kMaxIterations = 1000;
+    size_t iterations = 0;
+    vector<double> rank;
+    if (precision[0] == '0') {
+      rank = PageRank<double>(is_push, damping, tolerance, kMaxIterations, iterations);
+    } else {
+      vector<float> float_rank = PageRank<float>(is_push, static_cast<float>(damping), static_cast<float>(tolerance),
+                                                 kMaxIterations, iterations);
+      rank.assign(float_rank.begin(), float_rank.end());
+    }
+    out << "Количество итераций = " << iterations << endl;
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      out << i + 1 << " : " << rank[i] << endl;
+    }
+  }
+
+  // Находит ядерное число каждой вершины неориентированного графа алгоритмом Батагелжа-Заверсника:
+  // вершины хранятся отсортированными по текущей степени в корзинах, и вершина наименьшей степени
+  // удаляется за O(1) с уменьшением степеней соседей. Работает за O(V + E).
+  vector<size_t> CoreNumbers() const {
+    size_t n = count_of_vertexes_;
+    vector<size_t> degree(n);
+    size_t max_degree = 0;
+    for (size_t i = 0; i < n; ++i) {
+      degree[i] = OutDegree(i);
+      max_degree = max(max_degree, degree[i]);
+    }
+    // bin[d] - начало корзины степени d в массиве vertexes, position[v] - место вершины v в нем.
+    vector<size_t> bin(max_degree + 2, 0);
+    for (size_t i = 0; i < n; ++i) {
+      bin[degree[i] + 1]++;
+    }
+    for (size_t d = 0; d <= max_degree; ++d) {
+      bin[d + 1] += bin[d];
+    }
+    vector<size_t> vertexes(n);
+    vector<size_t> position(n);
+    vector<size_t> next_place(bin.begin(), bin.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+      position[i] = next_place[degree[i]]++;
+      vertexes[position[i]] = i;
+    }
+    for (size_t k = 0; k < n; ++k) {
+      size_t v = vertexes[k];
+      ForEachNeighbour(v, [&](size_t u) {
+        if (degree[u] <= degree[v])
+          return;
+        // Переносим u в начало ее корзины и сдвигаем границу корзины, уменьшая степень u.
+        size_t u_degree = degree[u];
+        size_t first_position = bin[u_degree];
+        size_t first_vertex = vertexes[first_position];
+        if (first_vertex != u) {
+          swap(vertexes[position[u]], vertexes[first_position]);
+          position[first_vertex] = position[u];
+          position[u] = first_position;
+        }
+        bin[u_degree]++;
+        degree[u]--;
+      });
+    }
+    return degree;
+  }
+
+  // Находит ядерные числа параллельным послойным удалением вершин: на уровне k одновременно удаляются
+  // все вершины степени не больше k, а соседи, степень которых при этом опустилась до k, образуют
+  // следующую волну того же уровня.
+  vector<size_t> ParallelCoreNumbers() const {
+    size_t n = count_of_vertexes_;
+    vector<atomic<size_t>> degree(n);
+    vector<char> is_removed(n, false);
+    vector<size_t> core(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+      degree[i].store(OutDegree(i), memory_order_relaxed);
+    }
+    size_t count_of_remaining = n;
+    for (size_t k = 0; count_of_remaining > 0; ++k) {
+      vector<size_t> frontier;
+      size_t min_degree = numeric_limits<size_t>::max();
+      for (size_t i = 0; i < n; ++i) {
+        if (!is_removed[i])
+          min_degree = min(min_degree, degree[i].load(memory_order_relaxed));
+      }
+      k = max(k, min_degree);
+      for (size_t i = 0; i < n; ++i) {
+        if (!is_removed[i] && degree[i].load(memory_order_relaxed) <= k)
+          frontier.push_back(i);
+      }
+      while (!frontier.empty()) {
+        for (size_t v : frontier) {
+          is_removed[v] = true;
+          core[v] = k;
+        }
+        count_of_remaining -= frontier.size();
+        vector<size_t> next_frontier;
+        mutex frontier_mutex;
+        ParallelFor(frontier.size(), [&](size_t begin, size_t end) {
+          vector<size_t> local_frontier;
+          for (size_t f = begin; f < end; ++f) {
+            ForEachNeighbour(frontier[f], [&](size_t u) {
+              if (!is_removed[u] && degree[u].fetch_sub(1, memory_order_relaxed) == k + 1)
+                local_frontier.push_back(u);
+            });
+          }
+          lock_guard<mutex> lock(frontier_mutex);
+          next_frontier.insert(next_frontier.end(), local_frontier.begin(), local_frontier.end());
+        });
+        frontier.swap(next_frontier);
+      }
+    }
+    return core;
+  }
+
+  // Выводит ядерные числа вершин и гистограмму размеров ядер.
+  // is_parallel - выбор параллельного послойного алгоритма вместо алгоритма Батагелжа-Заверсника.
+  void PrintCoreNumbers(bool is_parallel) {
+    if (is_orient_) {
+      cerr << "Ядра считаются только в неориентированном графе!" << endl;
+      return;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<size_t> core = is_parallel ? ParallelCoreNumbers() : CoreNumbers();
+    size_t max_core = 0;
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      out << i + 1 << " : " << core[i] << endl;
+      max_core = max(max_core, core[i]);
+    }
+    vector<size_t> histogram(max_core + 1, 0);
+    for (size_t value : core) {
+      histogram[value]++;
+    }
+    // Размер k-ядра - число вершин с ядерным числом не меньше k.
+    vector<size_t> core_size(max_core + 2, 0);
+    for (size_t k = max_core + 1; k-- > 0;) {
+      core_size[k] = core_size[k + 1] + histogram[k];
+    }
+    out << "Ядерное число : количество вершин, размер ядра" << endl;
+    for (size_t k = 0; k <= max_core && count_of_vertexes_ > 0; ++k) {
+      out << k << " : " << histogram[k] << ", " << core_size[k] << endl;
+    }
+  }
+
+  // Находит точки сочленения, мосты и компоненты двусвязности неориентированного графа за один
+  // нерекурсивный обход dfs: low[v] - наименьшее время входа, достижимое из поддерева v
+  // с помощью не более чем одного обратного ребра. Компоненты двусвязности задаются списками ребер.
+  void FindCutStructure(vector<size_t> &articulation_points,
+                        vector<pair<size_t, size_t>> &bridges,
+                        vector<vector<pair<size_t, size_t>>> &biconnected_components) const {
+    const size_t kUnvisited = numeric_limits<size_t>::max();
+    vector<size_t> entry(count_of_vertexes_, kUnvisited);
+    vector<size_t> low(count_of_vertexes_, kUnvisited);
+    vector<bool> is_articulation(count_of_vertexes_, false);
+    struct Frame {
+      size_t vertex;
+      size_t parent;
+      NeighbourCursor cursor;
+    };
+    vector<Frame> call_stack;
+    vector<pair<size_t, size_t>> edges_stack;
+    size_t timer = 0;
+    for (size_t root = 0; root < count_of_vertexes_; ++root) {
+      if (entry[root] != kUnvisited)
+        continue;
+      entry[root] = low[root] = timer++;
+      call_stack.push_back({root, kUnvisited, NeighboursBegin(root)});
+      size_t count_of_root_children = 0;
+      while (!call_stack.empty()) {
+        size_t current_vertex = call_stack.back().vertex;
+        size_t i;
+        if (NextNeighbour(call_stack.back().cursor, i)) {
+          if (i == call_stack.back().parent || i == current_vertex)
+            continue;
+          if (entry[i] == kUnvisited) {
+            if (current_vertex == root)
+              count_of_root_children++;
+            edges_stack.emplace_back(current_vertex, i);
+            entry[i] = low[i] = timer++;
+            call_stack.push_back({i, current_vertex, NeighboursBegin(i)});
+          } else if (entry[i] < entry[current_vertex]) {
+            low[current_vertex] = min(low[current_vertex], entry[i]);
+            edges_stack.emplace_back(current_vertex, i);
+          }
+          continue;
+        }
+        call_stack.pop_back();
+        if (call_stack.empty())
+          break;
+        size_t parent = call_stack.back().vertex;
+        low[parent] = min(low[parent], low[current_vertex]);
+        if (low[current_vertex] > entry[parent])
+          bridges.emplace_back(min(parent, current_vertex), max(parent, current_vertex));
+        if (low[current_vertex] >= entry[parent]) {
+          if (parent != root)
+            is_articulation[parent] = true;
+          vector<pair<size_t, size_t>> component;
+          pair<size_t, size_t> edge;
+          do {
+            edge = edges_stack.back();
+            edges_stack.pop_back();
+            component.push_back(edge);
+          } while (edge != make_pair(parent, current_vertex));
+          biconnected_components.push_back(move(component));
+        }
+      }
+      if (count_of_root_children > 1)
+        is_articulation[root] = true;
+    }
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      if (is_articulation[i])
+        articulation_points.push_back(i);
+    }
+    sort(bridges.begin(), bridges.end());
+  }
+
+  // Выводит точки сочленения, мосты и компоненты двусвязности.
+  void PrintCutStructure() {
+    if (is_orient_) {
+      cerr << "Точки сочленения и мосты ищутся только в неориентированном графе!" << endl;
+      return;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<size_t> articulation_points;
+    vector<pair<size_t, size_t>> bridges;
+    vector<vector<pair<size_t, size_t>>> biconnected_components;
+    FindCutStructure(articulation_points, bridges, biconnected_components);
+    out << "Точки сочленения:";
+    for (size_t vertex : articulation_points) {
+      out << " " << vertex + 1;
+    }
+    out << endl << "Мосты:" << endl;
+    for (auto bridge : bridges) {
+      out << bridge.first + 1 << " " << bridge.second + 1 << endl;
+    }
+    for (size_t i = 0; i < biconnected_components.size(); ++i) {
+      out << i + 1 << "-ая компонента двусвязности:" << endl;
+      for (auto edge : biconnected_components[i]) {
+        out << edge.first + 1 << " " << edge.second + 1 << endl;
+      }
+      out << "-------------------------" << endl;
+    }
+  }
+
+  // Топологическая сортировка алгоритмом Кана. Вершины снимаются уровнями: уровень - все вершины,
+  // у которых не осталось входящих дуг; дуги вершин одного уровня обрабатываются параллельно.
+  // Возвращает false, если в графе есть цикл, и тогда cycle - вершины одного из циклов по порядку.
+  bool TopologicalSort(vector<size_t> &order, vector<size_t> &cycle) const {
+    size_t n = count_of_vertexes_;
+    vector<atomic<size_t>> in_degree(n);
+    ParallelFor(n, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        ForEachNeighbour(i, [&](size_t j) { in_degree[j].fetch_add(1, memory_order_relaxed); });
+      }
+    });
+    order.clear();
+    vector<size_t> frontier;
+    for (size_t i = 0; i < n; ++i) {
+      if (in_degree[i].load(memory_order_relaxed) == 0)
+        frontier.push_back(i);
+    }
+    while (!frontier.empty()) {
+      order.insert(order.end(), frontier.begin(), frontier.end());
+      vector<size_t> next_frontier;
+      mutex frontier_mutex;
+      ParallelFor(frontier.size(), [&](size_t begin, size_t end) {
+        vector<size_t> local_frontier;
+        for (size_t k = begin; k < end; ++k) {
+          ForEachNeighbour(frontier[k], [&](size_t j) {
+            if (in_degree[j].fetch_sub(1, memory_order_relaxed) == 1)
+              local_frontier.push_back(j);
+          });
+        }
+        lock_guard<mutex> lock(frontier_mutex);
+        next_frontier.insert(next_frontier.end(), local_frontier.begin(), local_frontier.end());
+      });
+      sort(next_frontier.begin(), next_frontier.end());
+      frontier.swap(next_frontier);
+    }
+    if (order.size() == n)
+      return true;
+    // Оставшиеся вершины содержат цикл: ищем обратную дугу обходом dfs только по ним.
+    // color: 0 - не посещена, 1 - в стеке обхода, 2 - обработана.
+    vector<char> color(n, 0);
+    for (size_t i : order) {
+      color[i] = 2;
+    }
+    vector<NeighbourCursor> call_stack;
+    vector<size_t> path;
+    for (size_t start_vertex = 0; start_vertex < n; ++start_vertex) {
+      if (color[start_vertex] != 0)
+        continue;
+      color[start_vertex] = 1;
+      path.push_back(start_vertex);
+      call_stack.push_back(NeighboursBegin(start_vertex));
+      while (!call_stack.empty()) {
+        size_t i;
+        if (NextNeighbour(call_stack.back(), i)) {
+          if (color[i] == 1) {
+            cycle.assign(find(path.begin(), path.end(), i), path.end());
+            return false;
+          }
+          if (color[i] == 0) {
+            color[i] = 1;
+            path.push_back(i);
+            call_stack.push_back(NeighboursBegin(i));
+          }
+          continue;
+        }
+        color[path.back()] = 2;
+        path.pop_back();
+        call_stack.pop_back();
+      }
+    }
+    return false;
+  }
+
+  // Находит самый длинный (критический) путь в ациклическом графе динамикой по топологическому порядку.
+  // Длина пути - сумма весов дуг (в невзвешенном графе - число дуг); путь может начинаться в любой вершине.
+  // Возвращает false, если граф не ацикличен.
+  bool LongestPath(vector<size_t> &path, Weight &length) const {
+    vector<size_t> order;
+    vector<size_t> cycle;
+    path.clear();
+    length = 0;
+    if (!TopologicalSort(order, cycle))
+      return false;
+    const size_t kNoParent = numeric_limits<size_t>::max();
+    vector<Weight> distance(count_of_vertexes_, 0);
+    vector<size_t> parent(count_of_vertexes_, kNoParent);
+    for (size_t current_vertex : order) {
+      ForEachWeightedNeighbour(current_vertex, [&](size_t i, Weight weight) {
+        if (distance[current_vertex] + weight > distance[i]) {
+          distance[i] = distance[current_vertex] + weight;
+          parent[i] = current_vertex;
+        }
+      });
+    }
+    if (count_of_vertexes_ == 0)
+      return true;
+    size_t last = static_cast<size_t>(max_element(distance.begin(), distance.end()) - distance.begin());
+    length = distance[last];
+    for (size_t vertex = last; vertex != kNoParent; vertex = parent[vertex]) {
+      path.push_back(vertex);
+    }
+    reverse(path.begin(), path.end());
+    return true;
+  }
+
+  // Выводит цикл графа.
+  static void PrintCycle(ostream &out, const vector<size_t> &cycle) {
+    out << "Граф содержит цикл:";
+    for (size_t vertex : cycle) {
+      out << " " << vertex + 1;
+    }
+    out << " " << cycle.front() + 1 << endl;
+  }
+
+  // Выводит вершины в топологическом порядке или цикл, если граф не ацикличен.
+  void PrintTopologicalSort() {
+    if (!is_orient_) {
+      cerr << "Топологическая сортировка возможна только в ориентированном графе!" << endl;
+      return;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<size_t> order;
+    vector<size_t> cycle;
+    if (!TopologicalSort(order, cycle)) {
+      PrintCycle(out, cycle);
+      return;
+    }
+    for (size_t vertex : order) {
+      out << vertex + 1 << " ";
+    }
+    out << endl;
+  }
+
+  // Выводит самый длинный путь ациклического графа.
+  void PrintLongestPath() {
+    if (!is_orient_) {
+      cerr << "Критический путь ищется только в ориентированном графе!" << endl;
+      return;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<size_t> path;
+    Weight length;
+    if (!LongestPath(path, length)) {
+      vector<size_t> order;
+      vector<size_t> cycle;
+      TopologicalSort(order, cycle);
+      PrintCycle(out, cycle);
+      return;
+    }
+    out << "Длина критического пути = " << length << endl;
+    for (size_t vertex : path) {
+      out << vertex + 1 << " ";
+    }
+    out << endl;
+  }
+
+  // Находит компоненты связности неориентированного графа параллельными объединениями
+  // концов ребер. Возвращает списки вершин компонент, упорядоченные по наименьшей вершине.
+  vector<vector<size_t>> ConnectedComponents() const {
+    ConcurrentDisjointSets sets(count_of_vertexes_);
+    ParallelFor(count_of_vertexes_, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        ForEachNeighbour(i, [&](size_t j) {
+          if (i < j)
+            sets.Unite(i, j);
+        });
+      }
+    });
+    vector<vector<size_t>> components;
+    vector<size_t> component_of_root(count_of_vertexes_, numeric_limits<size_t>::max());
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      size_t root = sets.Find(i);
+      if (component_of_root[root] == numeric_limits<size_t>::max()) {
+        component_of_root[root] = components.size();
+        components.emplace_back();
+      }
+      components[component_of_root[root]].push_back(i);
+    }
+    return components;
+  }
+
+  // Проверяет, что неориентированный граф двудольный, раскрашивая вершины в два цвета по четности
+  // уровня bfs; компоненты обходятся параллельно, затем параллельно проверяются ребра.
+  // Если граф не двудольный, возвращает false и нечетный цикл в odd_cycle: ребро внутри уровня
+  // и пути от его концов до их общего предка в дереве bfs; петля дает цикл из одной вершины.
+  bool TwoColoring(vector<char> &color, vector<size_t> &odd_cycle) const {
+    vector<vector<size_t>> components = ConnectedComponents();
+    vector<VertexId> level(count_of_vertexes_, kNoVertex);
+    vector<VertexId> parent(count_of_vertexes_, kNoVertex);
+    ParallelForDynamic(components.size(), [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) {
+        ContinueBfsLevels({components[c].front()}, level, parent);
+      }
+    }, components.size() / (4 * CountOfThreads()));
+    color.assign(count_of_vertexes_, 0);
+    // Концы ребра bfs лежат на соседних уровнях или на одном, и только во втором случае
+    // у них один цвет. Концы петли тоже лежат на одном уровне.
+    atomic<size_t> conflict = kNoVertex;
+    ParallelFor(count_of_vertexes_, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        color[i] = static_cast<char>(level[i] % 2);
+        if (conflict.load(memory_order_relaxed) != kNoVertex)
+          continue;
+        ForEachNeighbour(i, [&](size_t j) {
+          if (level[j] == level[i])
+            conflict.store(i, memory_order_relaxed);
+        });
+      }
+    });
+    if (conflict == kNoVertex)
+      return true;
+    size_t first = conflict;
+    size_t second = first;
+    ForEachNeighbour(first, [&](size_t j) {
+      if (level[j] == level[first])
+        second = j;
+    });
+    // Концы ребра на одном уровне: поднимаемся от обоих до общего предка.
+    vector<size_t> left = {first};
+    vector<size_t> right = {second};
+    while (left.back() != right.back()) {
+      left.push_back(parent[left.back()]);
+      right.push_back(parent[right.back()]);
+    }
+    odd_cycle.assign(left.begin(), left.end());
+    odd_cycle.insert(odd_cycle.end(), right.rbegin() + 1, right.rend());
+    return false;
+  }
+
+  // Выводит доли двудольного графа или нечетный цикл, если граф не двудольный.
+  void PrintBipartiteness() {
+    if (is_orient_) {
+      cerr << "Двудольность проверяется только в неориентированном графе!" << endl;
+      return;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<char> color;
+    vector<size_t> odd_cycle;
+    if (!TwoColoring(color, odd_cycle)) {
+      out << "Граф не двудольный, нечетный цикл:";
+      for (size_t vertex : odd_cycle) {
+        out << " " << vertex + 1;
+      }
+      out << " " << odd_cycle.front() + 1 << endl;
+      return;
+    }
+    out << "Граф двудольный" << endl;
+    for (char part = 0; part < 2; ++part) {
+      out << static_cast<int>(part) + 1 << "-ая доля:";
+      for (size_t i = 0; i < count_of_vertexes_; ++i) {
+        if (color[i] == part)
+          out << " " << i + 1;
+      }
+      out << endl;
+    }
+  }
+
+  // Ребро неориентированного взвешенного графа (вершины нумеруются с 0).
+  struct WeightedEdge {
+    Weight weight;
+    size_t from;
+    size_t to;
+  };
+
+  // Выписывает ребра неориентированного графа с весами.
+  vector<WeightedEdge> GetWeightedEdges() const {
+    vector<WeightedEdge> edges;
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      ForEachWeightedNeighbour(i, [&](size_t j, Weight weight) {
+        if (i < j)
+          edges.push_back({weight, i, j});
+      });
+    }
+    return edges;
+  }
+
+  // Находит минимальный остовный лес алгоритмом Крускала: ребра сортируются по весу параллельно
+  // и добавляются, если соединяют разные множества системы непересекающихся множеств.
+  vector<WeightedEdge> KruskalForest() const {
+    vector<WeightedEdge> edges = GetWeightedEdges();
+    ParallelSort(edges, [](const WeightedEdge &left, const WeightedEdge &right) {
+      return left.weight < right.weight;
+    });
+    DisjointSets sets(count_of_vertexes_);
+    vector<WeightedEdge> forest;
+    for (const auto &edge : edges) {
+      if (sets.Unite(edge.from, edge.to))
+        forest.push_back(edge);
+    }
+    return forest;
+  }
+
+  // Находит минимальный остовный лес параллельным алгоритмом Борувки: на каждом шаге для каждой
+  // компоненты параллельно выбирается самое легкое выходящее из нее ребро, и все выбранные ребра
+  // добавляются в лес. Равные по весу ребра упорядочиваются по номеру, поэтому циклов не возникает.
+  vector<WeightedEdge> BoruvkaForest() const {
+    vector<WeightedEdge> edges = GetWeightedEdges();
+    const size_t kNoEdge = numeric_limits<size_t>::max();
+    auto is_lighter = [&](size_t left, size_t right) {
+      return right == kNoEdge || edges[left].weight < edges[right].weight
+          || (edges[left].weight == edges[right].weight && left < right);
+    };
+    ConcurrentDisjointSets sets(count_of_vertexes_);
+    vector<atomic<size_t>> lightest(count_of_vertexes_);
+    vector<WeightedEdge> forest;
+    vector<size_t> alive(edges.size());
+    for (size_t k = 0; k < edges.size(); ++k) {
+      alive[k] = k;
+    }
+    while (!alive.empty()) {
+      for (auto &value : lightest) {
+        value.store(kNoEdge, memory_order_relaxed);
+      }
+      // Предлагает ребро k как самое легкое для компоненты component.
+      auto propose = [&](size_t component, size_t k) {
+        size_t current = lightest[component].load(memory_order_relaxed);
+        while (is_lighter(k, current)) {
+          if (lightest[component].compare_exchange_weak(current, k, memory_order_relaxed))
+            return;
+        }
+      };
+      ParallelFor(alive.size(), [&](size_t begin, size_t end) {
+        for (size_t a = begin; a < end; ++a) {
+          size_t k = alive[a];
+          size_t from = sets.Find(edges[k].from);
+          size_t to = sets.Find(edges[k].to);
+          if (from == to)
+            continue;
+          propose(from, k);
+          propose(to, k);
+        }
+      });
+      bool was_add = false;
+      for (size_t i = 0; i < count_of_vertexes_; ++i) {
+        size_t k = lightest[i].load(memory_order_relaxed);
+        if (k == kNoEdge || sets.Find(edges[k].from) == sets.Find(edges[k].to))
+          continue;
+        sets.Unite(edges[k].from, edges[k].to);
+        forest.push_back(edges[k]);
+        was_add = true;
+      }
+      if (!was_add)
+        break;
+      erase_if(alive, [&](size_t k) { return sets.Find(edges[k].from) == sets.Find(edges[k].to); });
+    }
+    return forest;
+  }
+
+  // Выводит минимальный остовный лес в виде списка ребер.
+  // is_boruvka - выбор алгоритма Борувки вместо алгоритма Крускала.
+  void PrintMinimumSpanningForest(bool is_boruvka) {
+    if (is_orient_) {
+      cerr << "Остовный лес ищется только в неориентированном графе!" << endl;
+      return;
+    }
+    vector<WeightedEdge> forest = is_boruvka ? BoruvkaForest() : KruskalForest();
+    sort(forest.begin(), forest.end(), [](const WeightedEdge &left, const WeightedEdge &right) {
+      return make_pair(left.from, left.to) < make_pair(right.from, right.to);
+    });
+    Weight total_weight = 0;
+    for (const auto &edge : forest) {
+      total_weight += edge.weight;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    out << "Вес остовного леса = " << total_weight << ", ребер = " << forest.size() << endl;
+    for (const auto &edge : forest) {
+      out << edge.from + 1 << " " << edge.to + 1;
+      if (is_weighted_)
+        out << " " << edge.weight;
+      out << endl;
+    }
+  }
+
+  // Находит максимальный поток из source в sink алгоритмом проталкивания предпотока с выбором
+  // самой высокой активной вершины, эвристикой разрыва и периодическим глобальным пересчетом высот.
+  // Пропускная способность дуги - ее вес (в невзвешенном графе - 1). Заполняет source_side - вершины,
+  // из которых сток недостижим в остаточной сети, и cut_arcs - дуги минимального разреза.
+  Weight MaxFlow(size_t source,
+                 size_t sink,
+                 vector<size_t> &source_side,
+                 vector<pair<size_t, size_t>> &cut_arcs) const {
+    size_t n = count_of_vertexes_;
+    // Остаточная сеть в формате CSR: для каждой дуги u -> v есть прямая дуга у u и обратная
+    // с нулевой пропускной способностью у v; reverse[e] - номер парной дуги.
+    vector<size_t> residual_offsets(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+      ForEachNeighbour(i, [&](size_t j) {
+        residual_offsets[i + 1]++;
+        residual_offsets[j + 1]++;
+      });
+    }
+    for (size_t i = 0; i < n; ++i) {
+      residual_offsets[i + 1] += residual_offsets[i];
+    }
+    vector<size_t> head(residual_offsets[n]);
+    vector<Weight> capacity(residual_offsets[n], 0);
+    vector<size_t> reverse(residual_offsets[n]);
+    vector<bool> is_forward(residual_offsets[n], false);
+    vector<size_t> position(residual_offsets.begin(), residual_offsets.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+      ForEachWeightedNeighbour(i, [&](size_t j, Weight weight) {
+        size_t forward = position[i]++;
+        size_t backward = position[j]++;
+        head[forward] = j;
+        head[backward] = i;
+        capacity[forward] = weight;
+        is_forward[forward] = true;
+        reverse[forward] = backward;
+        reverse[backward] = forward;
+      });
+    }
+    vector<size_t> height(n, 0);
+    vector<Weight> excess(n, 0);
+    vector<size_t> current(residual_offsets.begin(), residual_offsets.end() - 1);
+    // Все вершины высоты h < n, активные и нет, - двусвязный список с головой level_head[h];
+    // n обозначает конец списка. top_level - наибольшая высота с непустым списком.
+    vector<size_t> level_head(n, n);
+    vector<size_t> level_next(n, n);
+    vector<size_t> level_previous(n, n);
+    size_t top_level = 0;
+    auto insert_into_level = [&](size_t vertex) {
+      size_t level = height[vertex];
+      level_previous[vertex] = n;
+      level_next[vertex] = level_head[level];
+      if (level_head[level] != n)
+        level_previous[level_head[level]] = vertex;
+      level_head[level] = vertex;
+      top_level = max(top_level, level);
+    };
+    auto erase_from_level = [&](size_t vertex) {
+      if (level_previous[vertex] != n)
+        level_next[level_previous[vertex]] = level_next[vertex];
+      else
+        level_head[height[vertex]] = level_next[vertex];
+      if (level_next[vertex] != n)
+        level_previous[level_next[vertex]] = level_previous[vertex];
+    };
+    vector<vector<size_t>> active(n + 1);
+    size_t highest = 0;
+    // Делает вершину активной, если у нее есть избыток и из нее еще можно дойти до стока.
+    auto activate = [&](size_t vertex) {
+      if (vertex == source || vertex == sink || excess[vertex] == 0 || height[vertex] >= n)
+        return;
+      active[height[vertex]].push_back(vertex);
+      highest = max(highest, height[vertex]);
+    };
+    // Глобальный пересчет высот: высота - расстояние до стока в остаточной сети (bfs по обратным дугам).
+    auto global_relabel = [&]() {
+      fill(height.begin(), height.end(), n);
+      fill(level_head.begin(), level_head.end(), n);
+      top_level = 0;
+      for (auto &bucket : active) {
+        bucket.clear();
+      }
+      highest = 0;
+      height[sink] = 0;
+      vector<size_t> vertexes_queue = {sink};
+      for (size_t k = 0; k < vertexes_queue.size(); ++k) {
+        size_t current_vertex = vertexes_queue[k];
+        insert_into_level(current_vertex);
+        for (size_t e = residual_offsets[current_vertex]; e < residual_offsets[current_vertex + 1]; ++e) {
+          size_t i = head[e];
+          if (capacity[reverse[e]] > 0 && height[i] == n && i != source) {
+            height[i] = height[current_vertex] + 1;
+            vertexes_queue.push_back(i);
+          }
+        }
+      }
+      for (size_t i = 0; i < n; ++i) {
+        current[i] = residual_offsets[i];
+        activate(i);
+      }
+    };
+    for (size_t e = residual_offsets[source]; e < residual_offsets[source + 1]; ++e) {
+      Weight flow = capacity[e];
+      capacity[e] -= flow;
+      capacity[reverse[e]] += flow;
+      excess[head[e]] += flow;
+      excess[source] -= flow;
+    }
+    global_relabel();
+    size_t count_of_relabels = 0;
+    while (true) {
+      while (highest > 0 && active[highest].empty()) {
+        --highest;
+      }
+      if (active[highest].empty())
+        break;
+      size_t vertex = active[highest].back();
+      active[highest].pop_back();
+      if (height[vertex] != highest || excess[vertex] == 0)
+        continue;
+      // Разгрузка вершины: проталкивание по допустимым дугам, пока есть избыток.
+      while (excess[vertex] > 0) {
+        if (current[vertex] == residual_offsets[vertex + 1]) {
+          size_t old_height = height[vertex];
+          size_t new_height = n;
+          for (size_t e = residual_offsets[vertex]; e < residual_offsets[vertex + 1]; ++e) {
+            if (capacity[e] > 0)
+              new_height = min(new_height, height[head[e]] + 1);
+          }
+          erase_from_level(vertex);
+          if (level_head[old_height] == n) {
+            // Разрыв: вершины выше пустой высоты больше не могут дойти до стока.
+            // Просматриваются только списки высот выше разрыва.
+            for (size_t level = old_height + 1; level <= top_level; ++level) {
+              for (size_t i = level_head[level]; i != n; i = level_next[i]) {
+                height[i] = n;
+              }
+              level_head[level] = n;
+            }
+            top_level = old_height > 0 ? old_height - 1 : 0;
+            new_height = n;
+          }
+          height[vertex] = new_height;
+          current[vertex] = residual_offsets[vertex];
+          if (new_height >= n)
             break;
-          case 2:Bfs(i, is_used_vertex, vertexes);
+          insert_into_level(vertex);
+          if (++count_of_relabels % n == 0) {
+            global_relabel();
             break;
-          default:break;
+          }
+          continue;
         }
-        current_component++;
-        for (int vertex : vertexes) {
-          if (is_console)
-            cout << "Вершина #" << vertex + 1 << endl;
-          else
-            fout << "Вершина #" << vertex + 1 << endl;
+        size_t e = current[vertex];
+        size_t i = head[e];
+        if (capacity[e] > 0 && height[vertex] == height[i] + 1) {
+          Weight flow = min(excess[vertex], capacity[e]);
+          bool was_inactive = excess[i] == 0;
+          capacity[e] -= flow;
+          capacity[reverse[e]] += flow;
+          excess[vertex] -= flow;
+          excess[i] += flow;
+          if (was_inactive)
+            activate(i);
+        } else {
+          ++current[vertex];
+        }
+      }
+      activate(vertex);
+    }
+    // Сторона истока минимального разреза - вершины, из которых сток недостижим в остаточной сети.
+    vector<bool> reaches_sink(n, false);
+    reaches_sink[sink] = true;
+    vector<size_t> vertexes_queue = {sink};
+    for (size_t k = 0; k < vertexes_queue.size(); ++k) {
+      size_t current_vertex = vertexes_queue[k];
+      for (size_t e = residual_offsets[current_vertex]; e < residual_offsets[current_vertex + 1]; ++e) {
+        size_t i = head[e];
+        if (capacity[reverse[e]] > 0 && !reaches_sink[i]) {
+          reaches_sink[i] = true;
+          vertexes_queue.push_back(i);
+        }
+      }
+    }
+    source_side.clear();
+    cut_arcs.clear();
+    for (size_t i = 0; i < n; ++i) {
+      if (reaches_sink[i])
+        continue;
+      source_side.push_back(i);
+      for (size_t e = residual_offsets[i]; e < residual_offsets[i + 1]; ++e) {
+        if (is_forward[e] && reaches_sink[head[e]])
+          cut_arcs.emplace_back(i, head[e]);
+      }
+    }
+    return excess[sink];
+  }
+
+  // Выводит максимальный поток между двумя вершинами и минимальный разрез.
+  void PrintMaxFlow() {
+    if (HasNegativeWeights()) {
+      cerr << "В графе есть дуги отрицательного веса!" << endl;
+      return;
+    }
+    size_t source;
+    size_t sink;
+    if (!ReadVertex("Введите номер истока.", source) || !ReadVertex("Введите номер стока.", sink))
+      return;
+    if (source == sink) {
+      cerr << "Исток и сток совпадают!" << endl;
+      return;
+    }
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<size_t> source_side;
+    vector<pair<size_t, size_t>> cut_arcs;
+    Weight flow = MaxFlow(source, sink, source_side, cut_arcs);
+    out << "Максимальный поток = " << flow << endl;
+    out << "Сторона истока минимального разреза:";
+    for (size_t vertex : source_side) {
+      out << " " << vertex + 1;
+    }
+    out << endl << "Дуги минимального разреза:" << endl;
+    for (auto arc : cut_arcs) {
+      out << arc.first + 1 << " " << arc.second + 1 << endl;
+    }
+  }
+
+  // Находит кратчайшие расстояния от вершины source алгоритмом Дейкстры на двоичной куче.
+  vector<Weight> Dijkstra(size_t source) const {
+    vector<Weight> distance(count_of_vertexes_, kInfinity);
+    priority_queue<pair<Weight, size_t>, vector<pair<Weight, size_t>>, greater<>> vertexes_queue;
+    distance[source] = 0;
+    vertexes_queue.emplace(0, source);
+    while (!vertexes_queue.empty()) {
+      auto [current_distance, current_vertex] = vertexes_queue.top();
+      vertexes_queue.pop();
+      if (current_distance != distance[current_vertex])
+        continue;
+      ForEachWeightedNeighbour(current_vertex, [&](size_t i, Weight weight) {
+        if (current_distance + weight < distance[i]) {
+          distance[i] = current_distance + weight;
+          vertexes_queue.emplace(distance[i], i);
+        }
+      });
+    }
+    return distance;
+  }
+
+  // Находит кратчайшие расстояния от вершины source параллельным алгоритмом delta-stepping.
+  // Вершины раскладываются по корзинам ширины delta; легкие дуги (вес не больше delta)
+  // релаксируются, пока корзина не опустеет, тяжелые - один раз после этого.
+  vector<Weight> DeltaStepping(size_t source) const {
+    Weight max_weight = 1;
+    for (Weight weight : weights_) {
+      max_weight = max(max_weight, weight);
+    }
+    size_t count_of_arcs = max<size_t>(1, CountOfArcs());
+    Weight delta = max<Weight>(1, max_weight * static_cast<Weight>(count_of_vertexes_)
+        / static_cast<Weight>(count_of_arcs));
+    vector<atomic<Weight>> distance(count_of_vertexes_);
+    for (auto &value : distance) {
+      value.store(kInfinity, memory_order_relaxed);
+    }
+    distance[source] = 0;
+    map<Weight, vector<size_t>> buckets;
+    buckets[0].push_back(source);
+    // Релаксирует легкие или тяжелые дуги вершин vertexes и раскладывает улучшенные вершины по корзинам.
+    auto relax = [&](const vector<size_t> &vertexes, bool is_light) {
+      mutex buckets_mutex;
+      ParallelFor(vertexes.size(), [&](size_t begin, size_t end) {
+        vector<size_t> improved;
+        for (size_t k = begin; k < end; ++k) {
+          Weight current_distance = distance[vertexes[k]].load(memory_order_relaxed);
+          ForEachWeightedNeighbour(vertexes[k], [&](size_t i, Weight weight) {
+            if ((weight <= delta) != is_light)
+              return;
+            Weight candidate = current_distance + weight;
+            Weight old_distance = distance[i].load(memory_order_relaxed);
+            while (candidate < old_distance) {
+              if (distance[i].compare_exchange_weak(old_distance, candidate, memory_order_relaxed)) {
+                improved.push_back(i);
+                break;
+              }
+            }
+          });
+        }
+        lock_guard<mutex> lock(buckets_mutex);
+        for (size_t i : improved) {
+          buckets[distance[i].load(memory_order_relaxed) / delta].push_back(i);
+        }
+      });
+    };
+    while (!buckets.empty()) {
+      Weight bucket = buckets.begin()->first;
+      vector<size_t> settled;
+      while (buckets.count(bucket)) {
+        vector<size_t> frontier = move(buckets[bucket]);
+        buckets.erase(bucket);
+        // Вершина могла попасть в корзину несколько раз или уже переехать в более раннюю.
+        sort(frontier.begin(), frontier.end());
+        frontier.erase(unique(frontier.begin(), frontier.end()), frontier.end());
+        erase_if(frontier, [&](size_t i) { return distance[i].load(memory_order_relaxed) / delta != bucket; });
+        settled.insert(settled.end(), frontier.begin(), frontier.end());
+        relax(frontier, true);
+      }
+      sort(settled.begin(), settled.end());
+      settled.erase(unique(settled.begin(), settled.end()), settled.end());
+      relax(settled, false);
+    }
+    vector<Weight> result(count_of_vertexes_);
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      result[i] = distance[i].load(memory_order_relaxed);
+    }
+    return result;
+  }
+
+  // Выводит кратчайшие расстояния от заданной вершины.
+  // algorithm: 0 - алгоритм Дейкстры, 1 - delta-stepping.
+  void PrintShortestPaths(int algorithm) {
+    if (HasNegativeWeights()) {
+      cerr << "В графе есть дуги отрицательного веса!" << endl;
+      return;
+    }
+    size_t source;
+    if (!ReadVertex("Введите номер начальной вершины.", source))
+      return;
+    AsyncFileStream fout;
+    ostream &out = ChooseOutput(fout);
+    vector<Weight> distance = algorithm == 0 ? Dijkstra(source) : DeltaStepping(source);
+    for (size_t i = 0; i < count_of_vertexes_; ++i) {
+      out << i + 1 << " : ";
+      if (distance[i] == kInfinity)
+        out << "недостижима" << endl;
+      else
+        out << distance[i] << endl;
+    }
+  }
+
+  // Переводит уже построенные списки соседей в сжатое хранение (см. CompressedLists) и выводит объем
+  // памяти списков до и после сжатия. Графы, которые не помещаются в память в обычном виде, нужно
+  // загружать с переменной GRAPH_COMPRESS: тогда обычные списки не строятся вовсе.
+  void Compress() {
+    if (!is_compressed_) {
+      CompressedLists lists;
+      lists.is_weighted = is_weighted_;
+      lists.offsets.reserve(count_of_vertexes_ + 1);
+      vector<pair<size_t, Weight>> neighbours;
+      for (size_t i = 0; i < count_of_vertexes_; ++i) {
+        neighbours.clear();
+        ForEachWeightedNeighbour(i, [&](size_t j, Weight weight) { neighbours.emplace_back(j, weight); });
+        AppendCompressedList(neighbours, lists);
+      }
+      lists.offsets.push_back(lists.bytes.size());
+      if (lists.bytes.size() > numeric_limits<EdgeIndex>::max()) {
+        cerr << "Сжатые списки соседей не помещаются в тип смещений!" << endl;
+        return;
+      }
+      UseCompressedLists(move(lists));
+    }
+    size_t count_of_arcs = CountOfArcs();
+    size_t offsets_size = (count_of_vertexes_ + 1) * sizeof(EdgeIndex);
+    size_t plain_size = offsets_size + count_of_arcs * (sizeof(VertexId) + (is_weighted_ ? sizeof(Weight) : 0));
+    size_t compressed_size = offsets_size + compressed_neighbours_.size();
+    cout << "Списки соседей: " << plain_size << " байт, после сжатия: " << compressed_size << " байт" << endl;
+  }
+
+  // Расположение массивов графа с заданными размерами в опубликованном виде.
+  // Каждый массив выравнивается на 8 байт от начала заголовка.
+  static SharedGraphHeader SharedLayout(size_t count_of_vertexes, size_t count_of_arcs, bool is_weighted) {
+    auto align = [](size_t position) { return (position + 7) / 8 * 8; };
+    SharedGraphHeader header{};
+    header.vertex_id_size = sizeof(VertexId);
+    header.edge_index_size = sizeof(EdgeIndex);
+    header.count_of_vertexes = count_of_vertexes;
+    header.count_of_arcs = count_of_arcs;
+    header.is_weighted = is_weighted;
+    header.offsets_position = align(sizeof(SharedGraphHeader));
+    header.neighbours_position = align(header.offsets_position + (count_of_vertexes + 1) * sizeof(EdgeIndex));
+    header.weights_position = align(header.neighbours_position + count_of_arcs * sizeof(VertexId));
+    header.total_size = header.weights_position + (is_weighted ? count_of_arcs * sizeof(Weight) : 0);
+    return header;
+  }
+
+  // Размер графа в опубликованном виде в байтах.
+  size_t SharedSize() const {
+    return SharedLayout(count_of_vertexes_, CountOfArcs(), is_weighted_).total_size;
+  }
+
+  // Записывает граф в память memory размера SharedSize(). Заголовок с отметкой пишется последним,
+  // чтобы подключающийся процесс не принял недописанный граф за готовый. Сжатый граф не публикуется.
+  bool WriteShared(uint8_t *memory) const {
+    if (is_compressed_)
+      return false;
+    SharedGraphHeader header = SharedLayout(count_of_vertexes_, offsets_[count_of_vertexes_], is_weighted_);
+    header.count_of_edges = count_of_edges_;
+    header.is_orient = is_orient_;
+    copy(offsets_.begin(), offsets_.end(), reinterpret_cast<EdgeIndex *>(memory + header.offsets_position));
+    copy(neighbours_.begin(), neighbours_.end(), reinterpret_cast<VertexId *>(memory + header.neighbours_position));
+    copy(weights_.begin(), weights_.end(), reinterpret_cast<Weight *>(memory + header.weights_position));
+    memcpy(memory, &header, sizeof(header));
+    atomic_thread_fence(memory_order_release);
+    header.magic = kSharedGraphMagic;
+    memcpy(memory, &header.magic, sizeof(header.magic));
+    return true;
+  }
+
+  // Подключает опубликованный граф из отображенной памяти mapping размера size без копирования:
+  // списки соседей и веса читаются прямо из нее. Возвращает false, если память не содержит графа
+  // с такими типами номеров и смещений или он поврежден.
+  bool AttachShared(const shared_ptr<const void> &mapping, size_t size) {
+    const auto *memory = static_cast<const uint8_t *>(mapping.get());
+    SharedGraphHeader header;
+    if (size < sizeof(header))
+      return false;
+    memcpy(&header, memory, sizeof(header));
+    if (header.magic != kSharedGraphMagic || header.count_of_vertexes >= size / sizeof(EdgeIndex)
+        || header.count_of_arcs > size / sizeof(VertexId))
+      return false;
+    SharedGraphHeader layout = SharedLayout(header.count_of_vertexes, header.count_of_arcs, header.is_weighted);
+    if (header.vertex_id_size != sizeof(VertexId) || header.edge_index_size != sizeof(EdgeIndex)
+        || header.offsets_position != layout.offsets_position
+        || header.neighbours_position != layout.neighbours_position
+        || header.weights_position != layout.weights_position
+        || header.total_size != layout.total_size || header.total_size > size)
+      return false;
+    // Запросы обращаются к массивам без проверок, поэтому смещения и номера соседей проверяются здесь.
+    const auto *offsets = reinterpret_cast<const EdgeIndex *>(memory + header.offsets_position);
+    const auto *neighbours = reinterpret_cast<const VertexId *>(memory + header.neighbours_position);
+    if (offsets[0] != 0 || offsets[header.count_of_vertexes] != header.count_of_arcs
+        || !is_sorted(offsets, offsets + header.count_of_vertexes + 1))
+      return false;
+    size_t count_of_vertexes = header.count_of_vertexes;
+    if (any_of(neighbours, neighbours + header.count_of_arcs,
+               [count_of_vertexes](VertexId neighbour) { return static_cast<size_t>(neighbour) >= count_of_vertexes; }))
+      return false;
+    count_of_vertexes_ = header.count_of_vertexes;
+    count_of_edges_ = header.count_of_edges;
+    is_orient_ = header.is_orient;
+    is_weighted_ = header.is_weighted;
+    is_compressed_ = false;
+    count_of_compressed_arcs_ = 0;
+    vector<uint8_t>().swap(compressed_neighbours_);
+    vector<EdgeIndex>().swap(compressed_offsets_);
+    offsets_.Attach(mapping, offsets, count_of_vertexes_ + 1);
+    neighbours_.Attach(mapping, neighbours, header.count_of_arcs);
+    if (is_weighted_)
+      weights_.Attach(mapping, reinterpret_cast<const Weight *>(memory + header.weights_position),
+                      header.count_of_arcs);
+    else
+      weights_.clear();
+    InvalidateDerivedViews();
+    return true;
+  }
+
+  // Выводит количество ребер графа.
+  void PrintCountOfEdges() {
+    AsyncFileStream fout;
+    bool is_console = true;
+    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
+         << "чтобы вывести в файл." << endl << "> ";
+    string output_type;
+    cin >> output_type;
+    if (output_type[0] != '0') {
+      fout.Open(output_path_);
+      is_console = false;
+    }
+    if (is_orient_)
+      if (is_console)
+        cout << "Количество дуг = " << count_of_edges_ << endl;
+      else
+        fout << "Количество дуг = " << count_of_edges_ << endl;
+    else if (is_console)
+      cout << "Количество ребер = " << count_of_edges_ << endl;
+    else
+      fout << "Количество ребер = " << count_of_edges_ << endl;
+  }
+};
+
+// Граф с номерами вершин и смещениями минимально достаточной ширины.
+using AnyGraph = variant<Graph<uint16_t, uint32_t>,
+                         Graph<uint32_t, uint32_t>,
+                         Graph<uint32_t, uint64_t>,
+                         Graph<uint64_t, uint64_t>>;
+
+// Создает граф, выбирая самые узкие типы номеров вершин и смещений, в которые он помещается.
+AnyGraph MakeGraph(size_t count_of_vertexes,
+                   size_t count_of_edges,
+                   const vector<Arc> &arcs,
+                   const vector<Weight> &arc_weights,
+                   bool is_orient) {
+  if (count_of_vertexes <= numeric_limits<uint16_t>::max())
+    return Graph<uint16_t, uint32_t>(count_of_vertexes, count_of_edges, arcs, arc_weights, is_orient);
+  bool is_small_offsets = arcs.size() <= numeric_limits<uint32_t>::max();
+  if (count_of_vertexes <= numeric_limits<uint32_t>::max()) {
+    if (is_small_offsets)
+      return Graph<uint32_t, uint32_t>(count_of_vertexes, count_of_edges, arcs, arc_weights, is_orient);
+    return Graph<uint32_t, uint64_t>(count_of_vertexes, count_of_edges, arcs, arc_weights, is_orient);
+  }
+  return Graph<uint64_t, uint64_t>(count_of_vertexes, count_of_edges, arcs, arc_weights, is_orient);
+}
+
+// Создает граф со сжатыми списками соседей, выбирая самые узкие подходящие типы.
+AnyGraph MakeCompressedGraph(size_t count_of_vertexes, size_t count_of_edges, CompressedLists &&lists, bool is_orient) {
+  bool is_small_offsets = lists.bytes.size() <= numeric_limits<uint32_t>::max();
+  if (count_of_vertexes <= numeric_limits<uint16_t>::max() && is_small_offsets)
+    return Graph<uint16_t, uint32_t>(count_of_vertexes, count_of_edges, move(lists), is_orient);
+  if (count_of_vertexes <= numeric_limits<uint32_t>::max()) {
+    if (is_small_offsets)
+      return Graph<uint32_t, uint32_t>(count_of_vertexes, count_of_edges, move(lists), is_orient);
+    return Graph<uint32_t, uint64_t>(count_of_vertexes, count_of_edges, move(lists), is_orient);
+  }
+  return Graph<uint64_t, uint64_t>(count_of_vertexes, count_of_edges, move(lists), is_orient);
+}
+
+// Число дуг, которые при сжатой загрузке накапливаются, сортируются и сжимаются одной пачкой.
+const size_t kCompressedBatch = size_t{1} << 20;
+
+// Собирает дуги, прочитанные из файла, и строит по ним граф. Если задана переменная GRAPH_COMPRESS,
+// дуги не хранятся целиком: каждые kCompressedBatch дуг сортируются и сжимаются в отдельную пачку,
+// а в конце пачки сливаются прямо в сжатые списки соседей, минуя обычный формат CSR.
+class ArcCollector {
+ private:
+  bool is_compressed_ = IsCompressionRequested();
+  vector<Arc> arcs_;
+  vector<Weight> weights_;
+  // Пачка сжатой загрузки: дуги по возрастанию (откуда, куда, вес) без повторов, для каждой -
+  // разность с предыдущим началом, конец (разность с предыдущим, если начало то же) и вес в zigzag.
+  struct Batch {
+    vector<uint8_t> bytes;
+    size_t count_of_arcs = 0;
+  };
+  vector<tuple<size_t, size_t, Weight>> batch_arcs_;
+  vector<Batch> batches_;
+
+  // Сортирует накопленные дуги и сжимает их в новую пачку.
+  void FlushBatch() {
+    if (batch_arcs_.empty())
+      return;
+    ParallelSort(batch_arcs_, less<>());
+    Batch batch;
+    size_t previous_from = 0;
+    size_t previous_to = 0;
+    for (size_t k = 0; k < batch_arcs_.size(); ++k) {
+      auto [from, to, weight] = batch_arcs_[k];
+      // Из повторяющихся дуг остается первая, то есть дуга с наименьшим весом.
+      if (k > 0 && from == previous_from && to == previous_to)
+        continue;
+      EncodeVarint(from - previous_from, batch.bytes);
+      EncodeVarint(from == previous_from && batch.count_of_arcs > 0 ? to - previous_to : to, batch.bytes);
+      EncodeVarint(ZigZagEncode(weight), batch.bytes);
+      previous_from = from;
+      previous_to = to;
+      ++batch.count_of_arcs;
+    }
+    batch.bytes.shrink_to_fit();
+    batches_.push_back(move(batch));
+    batch_arcs_.clear();
+  }
+
+  // Сливает пачки в сжатые списки соседей, отбрасывая повторы дуг из разных пачек.
+  CompressedLists MergeBatches(size_t count_of_vertexes, bool is_weighted) {
+    FlushBatch();
+    vector<tuple<size_t, size_t, Weight>>().swap(batch_arcs_);
+    // Позиция чтения в пачке и ее последняя прочитанная дуга.
+    struct BatchCursor {
+      size_t byte = 0;
+      size_t remaining = 0;
+      size_t from = 0;
+      size_t to = 0;
+      Weight weight = 0;
+    };
+    vector<BatchCursor> cursors(batches_.size());
+    auto read_arc = [&](size_t b) {
+      BatchCursor &cursor = cursors[b];
+      const vector<uint8_t> &bytes = batches_[b].bytes;
+      size_t from_delta = DecodeVarint(bytes, cursor.byte);
+      size_t to = DecodeVarint(bytes, cursor.byte);
+      cursor.to = from_delta == 0 && cursor.remaining != batches_[b].count_of_arcs ? cursor.to + to : to;
+      cursor.from += from_delta;
+      cursor.weight = ZigZagDecode(DecodeVarint(bytes, cursor.byte));
+      --cursor.remaining;
+    };
+    using QueuedArc = tuple<size_t, size_t, Weight, size_t>;
+    priority_queue<QueuedArc, vector<QueuedArc>, greater<>> queue;
+    for (size_t b = 0; b < batches_.size(); ++b) {
+      cursors[b].remaining = batches_[b].count_of_arcs;
+      if (cursors[b].remaining == 0)
+        continue;
+      read_arc(b);
+      queue.emplace(cursors[b].from, cursors[b].to, cursors[b].weight, b);
+    }
+    CompressedLists lists;
+    lists.is_weighted = is_weighted;
+    lists.offsets.reserve(count_of_vertexes + 1);
+    vector<pair<size_t, Weight>> neighbours;
+    size_t vertex = 0;
+    while (!queue.empty()) {
+      auto [from, to, weight, b] = queue.top();
+      queue.pop();
+      if (cursors[b].remaining > 0) {
+        read_arc(b);
+        queue.emplace(cursors[b].from, cursors[b].to, cursors[b].weight, b);
+      } else {
+        vector<uint8_t>().swap(batches_[b].bytes);
+      }
+      if (from >= count_of_vertexes || to >= count_of_vertexes)
+        continue;
+      for (; vertex < from; ++vertex) {
+        AppendCompressedList(neighbours, lists);
+        neighbours.clear();
+      }
+      if (neighbours.empty() || neighbours.back().first != to)
+        neighbours.emplace_back(to, weight);
+    }
+    for (; vertex < count_of_vertexes; ++vertex) {
+      AppendCompressedList(neighbours, lists);
+      neighbours.clear();
+    }
+    lists.offsets.push_back(lists.bytes.size());
+    batches_.clear();
+    return lists;
+  }
+
+ public:
+  // Добавляет дугу (вершины нумеруются с 0) без веса.
+  void Add(size_t from, size_t to) {
+    if (is_compressed_) {
+      Add(from, to, 1);
+      return;
+    }
+    arcs_.emplace_back(from, to);
+  }
+
+  // Добавляет дугу с весом.
+  void Add(size_t from, size_t to, Weight weight) {
+    if (!is_compressed_) {
+      arcs_.emplace_back(from, to);
+      weights_.push_back(weight);
+      return;
+    }
+    batch_arcs_.emplace_back(from, to, weight);
+    if (batch_arcs_.size() == kCompressedBatch)
+      FlushBatch();
+  }
+
+  // Резервирует память под count дуг обычной загрузки.
+  void Reserve(size_t count) {
+    if (is_compressed_)
+      return;
+    arcs_.reserve(count);
+    weights_.reserve(count);
+  }
+
+  // Строит граф по собранным дугам; is_weighted - учитывать ли веса дуг.
+  AnyGraph Build(size_t count_of_vertexes, size_t count_of_edges, bool is_weighted, bool is_orient) {
+    if (is_compressed_)
+      return MakeCompressedGraph(count_of_vertexes, count_of_edges, MergeBatches(count_of_vertexes, is_weighted),
+                                 is_orient);
+    if (!is_weighted)
+      vector<Weight>().swap(weights_);
+    return MakeGraph(count_of_vertexes, count_of_edges, arcs_, weights_, is_orient);
+  }
+};
+
+// Осуществляет чтение матрицы смежности из потока.
+// Отличное от 0 и 1 значение в матрице считается весом ребра, и тогда граф считается взвешенным.
+void ReadAdjacencyMatrix(istream &in, AnyGraph &graph) {
+  size_t count_of_vertexes = 0;
+  size_t count_of_edges = 0;
+  bool is_orient = false;
+  in >> is_orient >> count_of_vertexes >> count_of_edges;
+  ArcCollector arcs;
+  bool is_weighted = false;
+  for (size_t i = 0; i < count_of_vertexes; ++i) {
+    for (size_t j = 0; j < count_of_vertexes; ++j) {
+      Weight value = 0;
+      in >> value;
+      if (value) {
+        arcs.Add(i, j, value);
+        is_weighted = is_weighted || value != 1;
+      }
+    }
+  }
+  graph = arcs.Build(count_of_vertexes, count_of_edges, is_weighted, is_orient);
+}
+
+// Осуществляет чтение списка из потока.
+// Третье число в строке ребра задает его вес; если веса нет ни у одного ребра, граф невзвешенный.
+void ReadListOfEdges(istream &in, AnyGraph &graph) {
+  size_t count_of_vertexes = 0;
+  size_t count_of_edges = 0;
+  bool is_orient = false;
+  in >> is_orient >> count_of_vertexes >> count_of_edges;
+  ArcCollector arcs;
+  arcs.Reserve(is_orient ? count_of_edges : 2 * count_of_edges);
+  bool is_weighted = false;
+  string line;
+  for (size_t i = 0; i < count_of_edges && getline(in, line);) {
+    istringstream stream(line);
+    size_t from;
+    size_t to;
+    if (!(stream >> from >> to))
+      continue;
+    Weight weight = 1;
+    if (stream >> weight)
+      is_weighted = true;
+    arcs.Add(from - 1, to - 1, weight);
+    if (!is_orient)
+      arcs.Add(to - 1, from - 1, weight);
+    ++i;
+  }
+  graph = arcs.Build(count_of_vertexes, count_of_edges, is_weighted, is_orient);
+}
+
+// Осуществляет чтение списка смежности из потока.
+void ReadAdjacencyList(istream &in, AnyGraph &graph) {
+  size_t count_of_vertexes = 0;
+  size_t count_of_edges = 0;
+  bool is_orient = false;
+  in >> is_orient >> count_of_vertexes >> count_of_edges;
+  ArcCollector arcs;
+  string line;
+  getline(in, line);
+  for (size_t i = 0; i < count_of_vertexes; ++i) {
+    getline(in, line);
+    if (line.empty())
+      continue;
+    istringstream stream(line);
+    size_t to;
+    while (stream >> to) {
+      arcs.Add(i, to - 1);
+      if (!is_orient)
+        arcs.Add(to - 1, i);
+    }
+  }
+  graph = arcs.Build(count_of_vertexes, count_of_edges, false, is_orient);
+}
+
+// Осуществляет чтение матрицы инцидентности из потока.
+// Матрица не хранится целиком: для каждого ребра запоминаются только его концы.
+void ReadIncidenceMatrix(istream &in, AnyGraph &graph) {
+  size_t count_of_vertexes = 0;
+  size_t count_of_edges = 0;
+  bool is_orient = false;
+  in >> is_orient >> count_of_vertexes >> count_of_edges;
+  const size_t kNoVertex = numeric_limits<size_t>::max();
+  vector<size_t> from(count_of_edges, kNoVertex);
+  vector<size_t> to(count_of_edges, kNoVertex);
+  for (size_t i = 0; i < count_of_vertexes; ++i) {
+    for (size_t j = 0; j < count_of_edges; ++j) {
+      int value = 0;
+      in >> value;
+      if (value == 0)
+        continue;
+      if (is_orient) {
+        if (value == 1)
+          to[j] = i;
+        else
+          from[j] = i;
+      } else {
+        if (from[j] == kNoVertex)
+          from[j] = i;
+        else
+          to[j] = i;
+      }
+    }
+  }
+  ArcCollector arcs;
+  for (size_t j = 0; j < count_of_edges; ++j) {
+    if (from[j] != kNoVertex && to[j] != kNoVertex) {
+      arcs.Add(from[j], to[j]);
+      if (!is_orient)
+        arcs.Add(to[j], from[j]);
+    }
+  }
+  graph = arcs.Build(count_of_vertexes, count_of_edges, false, is_orient);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// Имя вида /name задает сегмент разделяемой памяти POSIX, любое другое имя - путь к файлу.
+bool IsSharedMemoryName(const string &name) {
+  return name.size() > 1 && name[0] == '/' && name.find('/', 1) == string::npos;
+}
+
+// Открывает сегмент разделяемой памяти или файл с именем name.
+int OpenShared(const string &name, int flags, mode_t mode) {
+  if (IsSharedMemoryName(name))
+    return shm_open(name.c_str(), flags, mode);
+  return open(name.c_str(), flags, mode);
+}
+
+// Удаляет опубликованный граф. Процессы, которые уже подключили его, продолжают с ним работать.
+bool RemovePublishedGraph(const string &name) {
+  if (IsSharedMemoryName(name))
+    return shm_unlink(name.c_str()) == 0;
+  return unlink(name.c_str()) == 0;
+}
+
+// Публикует граф в сегменте разделяемой памяти или в файле name, откуда его могут подключить
+// другие процессы. Прежний граф с тем же именем сначала удаляется, а не перезаписывается:
+// подключенные к нему процессы сохраняют свое отображение. Возвращает false при ошибке.
+bool PublishGraph(const AnyGraph &graph, const string &name) {
+  RemovePublishedGraph(name);
+  bool is_created = false;
+  bool is_published = visit([&](const auto &typed_graph) {
+    size_t size = typed_graph.SharedSize();
+    int descriptor = OpenShared(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (descriptor < 0)
+      return false;
+    is_created = true;
+    if (ftruncate(descriptor, static_cast<off_t>(size)) != 0) {
+      close(descriptor);
+      return false;
+    }
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (memory == MAP_FAILED)
+      return false;
+    bool is_written = typed_graph.WriteShared(static_cast<uint8_t *>(memory));
+    munmap(memory, size);
+    return is_written;
+  }, graph);
+  if (!is_published && is_created)
+    RemovePublishedGraph(name);
+  return is_published;
+}
+
+// Подключает граф, опубликованный под именем name, только для чтения и без копирования.
+// Память остается отображенной, пока существует граф. Возвращает false при ошибке.
+bool AttachGraph(const string &name, AnyGraph &graph) {
+  int descriptor = OpenShared(name, O_RDONLY, 0);
+  if (descriptor < 0)
+    return false;
+  struct stat status{};
+  if (fstat(descriptor, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(SharedGraphHeader)) {
+    close(descriptor);
+    return false;
+  }
+  size_t size = static_cast<size_t>(status.st_size);
+  void *memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+  close(descriptor);
+  if (memory == MAP_FAILED)
+    return false;
+  shared_ptr<const void> mapping(memory, [size](const void *address) { munmap(const_cast<void *>(address), size); });
+  SharedGraphHeader header;
+  memcpy(&header, memory, sizeof(header));
+  if (header.vertex_id_size == sizeof(uint16_t))
+    graph = Graph<uint16_t, uint32_t>();
+  else if (header.vertex_id_size == sizeof(uint32_t) && header.edge_index_size == sizeof(uint32_t))
+    graph = Graph<uint32_t, uint32_t>();
+  else if (header.vertex_id_size == sizeof(uint32_t))
+    graph = Graph<uint32_t, uint64_t>();
+  else
+    graph = Graph<uint64_t, uint64_t>();
+  return visit([&](auto &typed_graph) { return typed_graph.AttachShared(mapping, size); }, graph);
+}
+#else
+// Разделяемая память недоступна на этой платформе.
+bool RemovePublishedGraph(const string &) {
+  return false;
+}
+
+bool PublishGraph(const AnyGraph &, const string &) {
+  cerr << "Разделяемая память не поддерживается на этой платформе!" << endl;
+  return false;
+}
+
+bool AttachGraph(const string &, AnyGraph &) {
+  cerr << "Разделяемая память не поддерживается на этой платформе!" << endl;
+  return false;
+}
+#endif
+
+// Размер одного буфера распакованных данных.
+const size_t kDecompressBufferSize = 1 << 20;
+
+// Количество буферов в кольце между потоком распаковки и разбором графа.
+const size_t kDecompressBufferCount = 4;
+
+// Размер порции сжатых данных, которая читается из файла за раз.
+const size_t kCompressedChunkSize = 1 << 18;
+
+// Формат сжатия файла графа.
+enum class Compression { kNone, kGzip, kZstd };
+
+// Определяет формат сжатия по первым байтам файла.
+Compression DetectCompression(const unsigned char *bytes, size_t size) {
+  if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b)
+    return Compression::kGzip;
+  if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd)
+    return Compression::kZstd;
+  return Compression::kNone;
+}
+
+// Возвращает true, если сборка умеет распаковывать данный формат.
+bool IsCompressionSupported(Compression compression) {
+  switch (compression) {
+    case Compression::kNone:return true;
+#ifdef GRAPH_HAVE_ZLIB
+    case Compression::kGzip:return true;
+#endif
+#ifdef GRAPH_HAVE_ZSTD
+    case Compression::kZstd:return true;
+#endif
+    default:return false;
+  }
+}
+
+// Буфер ввода, который распаковывает сжатый файл в отдельном потоке. Распакованные данные
+// передаются разбору через кольцо из kDecompressBufferCount буферов: пока разбирается один буфер,
+// следующие уже распаковываются. Поток распаковки отдельный, а не из пула, потому что он ждет диск.
+class DecompressingBuffer : public streambuf {
+ private:
+  filebuf file_;
+  Compression compression_;
+  array<vector<char>, kDecompressBufferCount> buffers_;
+  array<size_t, kDecompressBufferCount> sizes_{};
+  // Сколько буферов распаковано и сколько из них разбор уже вернул.
+  size_t count_of_produced_ = 0;
+  size_t count_of_released_ = 0;
+  bool is_reading_ = false;
+  bool is_finished_ = false;
+  bool is_failed_ = false;
+  bool is_stopped_ = false;
+  mutex mutex_;
+  condition_variable condition_;
+  thread worker_;
+
+  // Ждет свободный буфер кольца. Возвращает nullptr, если чтение прекращено.
+  char *AcquireBuffer() {
+    unique_lock<mutex> lock(mutex_);
+    condition_.wait(lock, [&] { return is_stopped_ || count_of_produced_ - count_of_released_ < kDecompressBufferCount; });
+    if (is_stopped_)
+      return nullptr;
+    return buffers_[count_of_produced_ % kDecompressBufferCount].data();
+  }
+
+  // Отдает разбору заполненный буфер.
+  void PublishBuffer(size_t size) {
+    if (size == 0)
+      return;
+    lock_guard<mutex> lock(mutex_);
+    sizes_[count_of_produced_ % kDecompressBufferCount] = size;
+    ++count_of_produced_;
+    condition_.notify_all();
+  }
+
+  // Отмечает конец распакованных данных.
+  void Finish(bool is_failed) {
+    lock_guard<mutex> lock(mutex_);
+    is_finished_ = true;
+    is_failed_ = is_failed;
+    condition_.notify_all();
+  }
+
+#ifdef GRAPH_HAVE_ZLIB
+  // Распаковывает gzip (в том числе несколько склеенных архивов). Возвращает false при ошибке в данных.
+  bool InflateGzip() {
+    z_stream stream{};
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+      return false;
+    vector<char> input(kCompressedChunkSize);
+    char *output = AcquireBuffer();
+    stream.next_out = reinterpret_cast<Bytef *>(output);
+    stream.avail_out = kDecompressBufferSize;
+    int status = Z_OK;
+    bool is_correct = output != nullptr;
+    while (output != nullptr) {
+      if (stream.avail_in == 0) {
+        stream.avail_in = static_cast<uInt>(file_.sgetn(input.data(), static_cast<streamsize>(input.size())));
+        stream.next_in = reinterpret_cast<Bytef *>(input.data());
+        if (stream.avail_in == 0) {
+          is_correct = status == Z_STREAM_END;
+          break;
+        }
+      }
+      if (status == Z_STREAM_END)
+        inflateReset(&stream);
+      status = inflate(&stream, Z_NO_FLUSH);
+      if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+        is_correct = false;
+        break;
+      }
+      if (stream.avail_out == 0) {
+        PublishBuffer(kDecompressBufferSize);
+        output = AcquireBuffer();
+        stream.next_out = reinterpret_cast<Bytef *>(output);
+        stream.avail_out = kDecompressBufferSize;
+      }
+    }
+    if (output != nullptr)
+      PublishBuffer(kDecompressBufferSize - stream.avail_out);
+    inflateEnd(&stream);
+    return is_correct;
+  }
+#endif
+
+#ifdef GRAPH_HAVE_ZSTD
+  // Распаковывает zstd (в том числе несколько кадров подряд). Возвращает false при ошибке в данных.
+  bool DecompressZstd() {
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if (stream == nullptr)
+      return false;
+    ZSTD_initDStream(stream);
+    vector<char> input_data(kCompressedChunkSize);
+    ZSTD_inBuffer input{input_data.data(), 0, 0};
+    char *output_data = AcquireBuffer();
+    ZSTD_outBuffer output{output_data, kDecompressBufferSize, 0};
+    size_t status = 0;
+    bool is_correct = output_data != nullptr;
+    while (output_data != nullptr) {
+      if (input.pos == input.size) {
+        input.size = static_cast<size_t>(file_.sgetn(input_data.data(), static_cast<streamsize>(input_data.size())));
+        input.pos = 0;
+        if (input.size == 0) {
+          is_correct = status == 0;
+          break;
         }
-        if (is_console)
-          cout << "-------------------------" << endl;
-        else
-          fout << "-------------------------" << endl;
       }
+      status = ZSTD_decompressStream(stream, &output, &input);
+      if (ZSTD_isError(status)) {
+        is_correct = false;
+        break;
+      }
+      if (output.pos == output.size) {
+        PublishBuffer(output.pos);
+        output_data = AcquireBuffer();
+        output = ZSTD_outBuffer{output_data, kDecompressBufferSize, 0};
+      }
+    }
+    if (output_data != nullptr)
+      PublishBuffer(output.pos);
+    ZSTD_freeDStream(stream);
+    return is_correct;
   }
+#endif
 
-  // Находит и выводит степень каждой вершины графа.
-  void PrintVertexDegree() {
-    ofstream fout;
-    bool is_console = true;
-    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
-         << "чтобы вывести в файл." << endl << "> ";
-    string output_type;
-    cin >> output_type;
-    if (output_type[0] != '0') {
-      fout = ofstream(output_path_);
-      is_console = false;
+  // Распаковывает весь файл, пока разбор не прекратит чтение.
+  void Decompress() {
+    bool is_correct = false;
+#ifdef GRAPH_HAVE_ZLIB
+    if (compression_ == Compression::kGzip)
+      is_correct = InflateGzip();
+#endif
+#ifdef GRAPH_HAVE_ZSTD
+    if (compression_ == Compression::kZstd)
+      is_correct = DecompressZstd();
+#endif
+    Finish(!is_correct);
+  }
+
+ protected:
+  // Возвращает разобранный буфер потоку распаковки и переходит к следующему.
+  int_type underflow() override {
+    unique_lock<mutex> lock(mutex_);
+    if (is_reading_) {
+      is_reading_ = false;
+      ++count_of_released_;
+      condition_.notify_all();
     }
-    for (size_t i = 0; i < count_of_vertexes_; ++i) {
-      if (is_console)
-        cout << i + 1 << " : ";
-      else
-        fout << i + 1 << " : ";
-      int cnt_out = 0;
-      int cnt_in = 0;
-      for (size_t j = 0; j < count_of_vertexes_; ++j) {
-        if (adjacency_matrix_[i][j])
-          cnt_out++;
-        if (adjacency_matrix_[j][i])
-          cnt_in++;
-      }
-      if (is_orient_)
-        if (is_console)
-          cout << "Исходящих = " << cnt_out << ", Входящих = " << cnt_in << endl;
-        else
-          fout << "Исходящих = " << cnt_out << ", Входящих = " << cnt_in << endl;
-      else if (is_console)
-        cout << "Степень = " << (cnt_out + cnt_in) / 2 << endl;
-      else
-        fout << "Степень = " << (cnt_out + cnt_in) / 2 << endl;
+    condition_.wait(lock, [&] { return is_finished_ || count_of_produced_ > count_of_released_; });
+    if (count_of_produced_ == count_of_released_)
+      return traits_type::eof();
+    is_reading_ = true;
+    size_t index = count_of_released_ % kDecompressBufferCount;
+    char *data = buffers_[index].data();
+    setg(data, data, data + sizes_[index]);
+    return traits_type::to_int_type(*gptr());
+  }
+
+ public:
+  // Начинает распаковку открытого файла в формате compression.
+  DecompressingBuffer(filebuf &&file, Compression compression) : file_(move(file)), compression_(compression) {
+    for (auto &buffer : buffers_) {
+      buffer.resize(kDecompressBufferSize);
     }
+    worker_ = thread([this] { Decompress(); });
   }
 
-  // Выводит количество ребер графа.
-  void PrintCountOfEdges() {
-    ofstream fout;
-    bool is_console = true;
-    cout << "Введите 0, если нужно вывести результат в консоль, и любое другое число," << endl
-         << "чтобы вывести в файл." << endl << "> ";
-    string output_type;
-    cin >> output_type;
-    if (output_type[0] != '0') {
-      fout = ofstream(output_path_);
-      is_console = false;
+  DecompressingBuffer(const DecompressingBuffer &) = delete;
+  DecompressingBuffer &operator=(const DecompressingBuffer &) = delete;
+
+  ~DecompressingBuffer() override {
+    {
+      lock_guard<mutex> lock(mutex_);
+      is_stopped_ = true;
+      condition_.notify_all();
     }
-    if (is_orient_)
-      if (is_console)
-        cout << "Количество дуг = " << count_of_edges_ << endl;
-      else
-        fout << "Количество дуг = " << count_of_edges_ << endl;
-    else if (is_console)
-      cout << "Количество ребер = " << count_of_edges_ << endl;
-    else
-      fout << "Количество ребер = " << count_of_edges_ << endl;
+    worker_.join();
+  }
+
+  // Возвращает true, если сжатые данные оказались повреждены или оборваны.
+  bool IsFailed() {
+    lock_guard<mutex> lock(mutex_);
+    return is_failed_;
   }
 };
 
-// Осуществляет чтение матрицы смежности из потока.
-void ReadAdjacencyMatrix(istream &in, Graph &graph) {
-  int count_of_vertexes = -1;
-  int count_of_edges = -1;
-  bool is_orient = false;
-  in >> is_orient >> count_of_vertexes >> count_of_edges;
-  vector<vector<int>> adjacency_matrix(count_of_vertexes, vector<int>(count_of_vertexes, 0));
-  for (size_t i = 0; i < adjacency_matrix.size(); ++i) {
-    for (size_t j = 0; j < adjacency_matrix.size(); ++j) {
-      in >> adjacency_matrix[i][j];
+// Поток ввода из файла графа. Сжатый файл (gzip или zstd, определяется по первым байтам)
+// распаковывается на лету, без временного файла на диске.
+class GraphFileStream : public istream {
+ private:
+  filebuf file_;
+  Compression compression_ = Compression::kNone;
+  unique_ptr<DecompressingBuffer> decompressor_;
+
+ public:
+  explicit GraphFileStream(const string &path) : istream(nullptr) {
+    if (file_.open(path, ios::in | ios::binary) == nullptr) {
+      setstate(ios::failbit);
+      return;
+    }
+    array<unsigned char, 4> magic{};
+    auto size = file_.sgetn(reinterpret_cast<char *>(magic.data()), magic.size());
+    compression_ = DetectCompression(magic.data(), static_cast<size_t>(max<streamsize>(size, 0)));
+    if (file_.pubseekpos(0, ios::in) != streampos(0) || !IsCompressionSupported(compression_)) {
+      setstate(ios::failbit);
+      return;
+    }
+    if (compression_ == Compression::kNone) {
+      rdbuf(&file_);
+      return;
     }
+    decompressor_ = make_unique<DecompressingBuffer>(std::move(file_), compression_);
+    rdbuf(decompressor_.get());
   }
-  graph = Graph(count_of_vertexes, count_of_edges, adjacency_matrix, is_orient);
-}
 
-// Осуществляет чтение списка из потока.
-void ReadListOfEdges(istream &in, Graph &graph) {
-  int count_of_vertexes = -1;
-  int count_of_edges = -1;
-  bool is_orient = false;
-  in >> is_orient >> count_of_vertexes >> count_of_edges;
-  vector<pair<int, int>> list_of_edges(count_of_edges);
-  for (int i = 0; i < count_of_edges; ++i) {
-    in >> list_of_edges[i].first >> list_of_edges[i].second;
+  // Формат сжатия файла.
+  Compression GetCompression() const {
+    return compression_;
   }
-  graph = Graph(count_of_vertexes,
-                count_of_edges,
-                FromEdgesListToAdjacencyMatrix(count_of_vertexes, list_of_edges, is_orient),
-                is_orient);
-}
 
-// Осуществляет чтение списка смежности из потока.
-void ReadAdjacencyList(istream &in, Graph &graph) {
-  int count_of_vertexes = -1;
-  int count_of_edges = -1;
-  bool is_orient = false;
-  in >> is_orient >> count_of_vertexes >> count_of_edges;
-  vector<vector<int>> adjacency_list(count_of_vertexes);
-  string line;
-  getline(in, line);
-  for (int i = 0; i < count_of_vertexes; ++i) {
-    getline(in, line);
-    if (line.empty())
-      continue;
-    istringstream stream(line);
-    int to;
-    while (stream >> to) {
-      adjacency_list[i].push_back(to - 1);
-      if (!is_orient)
-        adjacency_list[to - 1].push_back(i);
-    }
+  // Возвращает true, если файл открыт, а сжатые данные прочитаны без ошибок.
+  bool IsValid() {
+    return rdbuf() != nullptr && (decompressor_ == nullptr || !decompressor_->IsFailed());
+  }
+};
+
+// Читает из потока тип представления графа и сам граф. Возвращает true, если граф был считан успешно.
+bool ReadGraphFromStream(istream &in, AnyGraph &graph) {
+  int graph_type = -1;
+  in >> graph_type;
+  switch (graph_type) {
+    case 0:ReadAdjacencyMatrix(in, graph);
+      break;
+    case 1:ReadAdjacencyList(in, graph);
+      break;
+    case 2:ReadListOfEdges(in, graph);
+      break;
+    case 3:ReadIncidenceMatrix(in, graph);
+      break;
+    default:cerr << "Неверная команда!" << endl;
+      return false;
   }
-  graph = Graph(count_of_vertexes, count_of_edges,
-                FromAdjacencyListToAdjacencyMatrix(count_of_vertexes, adjacency_list),
-                is_orient);
+  return true;
 }
 
-// Осуществляет чтение матрицы инцидентности из потока.
-void ReadIncidenceMatrix(istream &in, Graph &graph) {
-  int count_of_vertexes = -1;
-  int count_of_edges = -1;
-  bool is_orient = false;
-  in >> is_orient >> count_of_vertexes >> count_of_edges;
-  vector<vector<int>> incidence_matrix(count_of_vertexes, vector<int>(count_of_edges));
-  for (int i = 0; i < count_of_vertexes; ++i) {
-    for (int j = 0; j < count_of_edges; ++j) {
-      in >> incidence_matrix[i][j];
-    }
+// Читает граф из файла в формате input.txt, возможно сжатого gzip или zstd.
+// Возвращает true, если граф был считан успешно.
+bool LoadGraphFile(const string &path, AnyGraph &graph) {
+  GraphFileStream fin(path);
+  if (!IsCompressionSupported(fin.GetCompression())) {
+    cerr << "Сжатие файла " << path << " не поддерживается этой сборкой!" << endl;
+    return false;
+  }
+  if (!fin.IsValid() || !ReadGraphFromStream(fin, graph) || !fin.IsValid()) {
+    cerr << "Ошибка чтения файла " << path << "!" << endl;
+    return false;
   }
-  auto adjancy_matrix =
-      FromIncidenceMatrixToAdjacencyMatrix(count_of_vertexes, count_of_edges, incidence_matrix, is_orient);
-  graph = Graph(count_of_vertexes, count_of_edges,
-                adjancy_matrix,
-                is_orient);
+  return true;
 }
 
 // Осуществляет чтение графа. Возвращает true, если граф был считан успешно.
-bool ReadGraph(Graph &graph, string &input_path) {
+bool ReadGraph(AnyGraph &graph, string &input_path) {
   cout << "Выберите способ ввода графа, введите 0, если ввод будет осуществлен с консоли," << endl
        << "или любое другое число, если необходимо считать граф с файла: " << endl << ">";
   string is_file_read;
   cin >> is_file_read;
-  ifstream fin;
-  int graph_type;
-  if (is_file_read[0] != '0') {
-    fin = ifstream(input_path);
-    if (!fin.is_open()) {
-      cerr << "Ошибка чтения файла!";
-      return false;
-    }
-    fin >> graph_type;
-  } else {
-    cin >> graph_type;
+  if (is_file_read[0] == '0')
+    return ReadGraphFromStream(cin, graph);
+  GraphFileStream fin(input_path);
+  if (!fin.IsValid()) {
+    cerr << "Ошибка чтения файла!";
+    return false;
   }
-  switch (graph_type) {
-    case 0:ReadAdjacencyMatrix(is_file_read[0] == '0' ? cin : fin, graph);
-      break;
-    case 1:ReadAdjacencyList(is_file_read[0] == '0' ? cin : fin, graph);
-      break;
-    case 2:ReadListOfEdges(is_file_read[0] == '0' ? cin : fin, graph);
-      break;
-    case 3:ReadIncidenceMatrix(is_file_read[0] == '0' ? cin : fin, graph);
-      break;
-    default:cerr << "Неверная команда!" << endl;
-      return false;
+  if (!ReadGraphFromStream(fin, graph))
+    return false;
+  if (!fin.IsValid()) {
+    cerr << "Ошибка распаковки файла!" << endl;
+    return false;
   }
   return true;
 }
@@ -613,50 +4597,584 @@ void PrintMenu() {
   cout << "7: Обойти граф с помощью bfs" << endl;
   cout << "8: Подсчет количества степеней" << endl;
   cout << "9: Подсчет количества ребер" << endl;
+  cout << "10: Сжать списки соседей" << endl;
+  cout << "11: Кратчайшие расстояния от вершины (алгоритм Дейкстры)" << endl;
+  cout << "12: Кратчайшие расстояния от вершины (параллельный delta-stepping)" << endl;
+  cout << "13: Расстояния в ребрах и дерево bfs от одной или нескольких вершин" << endl;
+  cout << "14: Путь с наименьшим числом ребер между двумя вершинами" << endl;
+  cout << "15: Эксцентриситеты вершин, радиус и диаметр" << endl;
+  cout << "16: Матрица расстояний в ребрах между всеми парами вершин" << endl;
+  cout << "17: Проверить достижимость одной вершины из другой" << endl;
+  cout << "18: Проверить достижимость по индексу достижимости" << endl;
+  cout << "19: Построить индекс достижимости и сохранить его в файл" << endl;
+  cout << "20: Загрузить индекс достижимости из файла" << endl;
+  cout << "21: Подсчет треугольников и коэффициентов кластеризации" << endl;
+  cout << "22: PageRank (режим pull)" << endl;
+  cout << "23: PageRank (режим push)" << endl;
+  cout << "24: Ядерные числа вершин (k-core)" << endl;
+  cout << "25: Ядерные числа вершин (параллельное удаление)" << endl;
+  cout << "26: Точки сочленения, мосты и компоненты двусвязности" << endl;
+  cout << "27: Топологическая сортировка" << endl;
+  cout << "28: Критический (самый длинный) путь в ациклическом графе" << endl;
+  cout << "29: Проверка двудольности" << endl;
+  cout << "30: Минимальный остовный лес (алгоритм Крускала)" << endl;
+  cout << "31: Минимальный остовный лес (параллельный алгоритм Борувки)" << endl;
+  cout << "32: Максимальный поток и минимальный разрез" << endl;
   cout << "0: Закончить работу с этим графом" << endl;
 }
 
 // Обрабатывает запросы пользователя.
-void Program(Graph &graph) {
+template<typename VertexId, typename EdgeIndex>
+void Program(Graph<VertexId, EdgeIndex> &graph) {
   PrintMenu();
   string command_type;
   while (true) {
     cout << "> ";
     cin >> command_type;
-    switch (command_type[0]) {
-      case '0':return;
-      case '1':graph.PrintAdjacencyMatrix();
+    if (command_type == "help") {
+      PrintMenu();
+      continue;
+    }
+    int command = -1;
+    from_chars(command_type.data(), command_type.data() + command_type.size(), command);
+    switch (command) {
+      case 0:return;
+      case 1:graph.PrintAdjacencyMatrix();
         break;
-      case '2':graph.PrintAdjacencyList();
+      case 2:graph.PrintAdjacencyList();
         break;
-      case '3':graph.PrintListOfEdges();
+      case 3:graph.PrintListOfEdges();
         break;
-      case '4':graph.PrintIncidenceMatrix();
+      case 4:graph.PrintIncidenceMatrix();
         break;
-      case '5':graph.GraphTravelsale(0);
+      case 5:graph.GraphTravelsale(0);
         break;
-      case '6':graph.GraphTravelsale(1);
+      case 6:graph.GraphTravelsale(1);
         break;
-      case '7':graph.GraphTravelsale(2);
+      case 7:graph.GraphTravelsale(2);
         break;
-      case '8':graph.PrintVertexDegree();
+      case 8:graph.PrintVertexDegree();
         break;
-      case '9':graph.PrintCountOfEdges();
+      case 9:graph.PrintCountOfEdges();
         break;
-      default:
-        if (command_type == "help") {
-          PrintMenu();
-          break;
+      case 10:graph.Compress();
+        break;
+      case 11:graph.PrintShortestPaths(0);
+        break;
+      case 12:graph.PrintShortestPaths(1);
+        break;
+      case 13:graph.PrintBfsDistances();
+        break;
+      case 14:graph.PrintPath();
+        break;
+      case 15:graph.PrintEccentricities();
+        break;
+      case 16:graph.PrintDistanceMatrix();
+        break;
+      case 17:graph.PrintReachability();
+        break;
+      case 18:graph.PrintReachabilityByIndex();
+        break;
+      case 19:
+        if (!graph.SaveReachabilityIndex())
+          cerr << "Ошибка записи индекса!" << endl;
+        break;
+      case 20:
+        if (!graph.LoadReachabilityIndex())
+          cerr << "Ошибка чтения индекса!" << endl;
+        break;
+      case 21:graph.PrintTriangles();
+        break;
+      case 22:graph.PrintPageRank(false);
+        break;
+      case 23:graph.PrintPageRank(true);
+        break;
+      case 24:graph.PrintCoreNumbers(false);
+        break;
+      case 25:graph.PrintCoreNumbers(true);
+        break;
+      case 26:graph.PrintCutStructure();
+        break;
+      case 27:graph.PrintTopologicalSort();
+        break;
+      case 28:graph.PrintLongestPath();
+        break;
+      case 29:graph.PrintBipartiteness();
+        break;
+      case 30:graph.PrintMinimumSpanningForest(false);
+        break;
+      case 31:graph.PrintMinimumSpanningForest(true);
+        break;
+      case 32:graph.PrintMaxFlow();
+        break;
+      default:cerr << "Неверная команда, повторите попытку!" << endl;
+        break;
+    }
+  }
+}
+
+
+// Граф с версиями для графа сервера, с номерами вершин той же ширины.
+using AnyVersionedGraph = variant<monostate,
+                                  unique_ptr<VersionedGraph<uint16_t>>,
+                                  unique_ptr<VersionedGraph<uint32_t>>,
+                                  unique_ptr<VersionedGraph<uint64_t>>>;
+
+// Граф сервера. При первом изменении из него строится граф с версиями, и дальше запросы
+// отвечаются по закрепленной текущей версии; исходный граф и его индекс остаются как были.
+struct ServedGraph {
+  AnyGraph graph;
+  AnyVersionedGraph versions;
+  atomic<bool> is_versioned = false;
+  mutex versions_mutex;
+};
+
+// Изменения одного клиента, накопленные до запроса commit: добавляемые и удаляемые дуги каждого графа.
+struct ServerSession {
+  map<size_t, pair<vector<Arc>, vector<Arc>>> pending;
+};
+
+// Отвечает на запрос чтения к исходному графу сервера.
+template<typename TypedGraph>
+string AnswerGraphQuery(const TypedGraph &graph, const string &command, const vector<size_t> &vertexes) {
+  ostringstream out;
+  if (command == "degree") {
+    out << graph.OutDegree(vertexes[0]);
+    if (graph.IsOrient())
+      out << ' ' << graph.InDegree(vertexes[0]);
+  } else if (command == "neighbours") {
+    vector<size_t> neighbours = graph.GetNeighbours(vertexes[0]);
+    for (size_t i = 0; i < neighbours.size(); ++i) {
+      out << (i ? " " : "") << neighbours[i] + 1;
+    }
+  } else if (command == "distance") {
+    auto distance = graph.BfsDistance(vertexes[0], vertexes[1]);
+    if (distance == graph.kNoVertex)
+      out << -1;
+    else
+      out << distance;
+  } else if (command == "reachable") {
+    out << graph.IsReachableInIndex(vertexes[0], vertexes[1]);
+  } else {
+    out << graph.ComponentOf(vertexes[0]) + 1;
+  }
+  return out.str();
+}
+
+// Отвечает на запрос чтения к закрепленной версии графа сервера. Достижимость проверяется обходом bfs,
+// а номера компонент известны только для исходного графа.
+template<typename Version>
+string AnswerVersionQuery(const Version &version, bool is_orient, const string &command, const vector<size_t> &vertexes) {
+  ostringstream out;
+  if (command == "degree") {
+    out << version.OutDegree(vertexes[0]);
+    if (is_orient)
+      out << ' ' << version.InDegree(vertexes[0]);
+  } else if (command == "neighbours") {
+    bool is_first = true;
+    version.ForEachNeighbour(vertexes[0], [&](size_t i) {
+      out << (is_first ? "" : " ") << i + 1;
+      is_first = false;
+    });
+  } else if (command == "distance" || command == "reachable") {
+    size_t distance = version.BfsDistance(vertexes[0], vertexes[1]);
+    bool is_reachable = distance != numeric_limits<size_t>::max();
+    if (command == "reachable")
+      out << is_reachable;
+    else if (is_reachable)
+      out << distance;
+    else
+      out << -1;
+  } else {
+    return "error: номера компонент известны только для исходной версии графа";
+  }
+  return out.str();
+}
+
+// Отвечает на один запрос к загруженным графам. Запрос - строка "команда граф вершины...",
+// графы и вершины нумеруются с 1:
+//   degree G V - степень вершины (в ориентированном графе - исходящая и входящая степени);
+//   neighbours G V - соседи вершины;
+//   distance G U V - расстояние в ребрах от U до V или -1, если пути нет;
+//   reachable G U V - 1, если V достижима из U, иначе 0;
+//   component G V - номер компоненты сильной связности (в неориентированном графе - связности);
+//   insert G U V, erase G U V - добавить или удалить дугу (ребро) в изменениях клиента session;
+//   commit G - применить изменения клиента одной новой версией графа, ответ - номер версии;
+//   version G - номер текущей версии графа (0 - исходный граф).
+// Ответ на неверный запрос начинается со слова error.
+string AnswerQuery(vector<ServedGraph> &graphs, ServerSession &session, const string &request) {
+  istringstream in(request);
+  string command;
+  size_t graph_number = 0;
+  in >> command;
+  size_t count_of_arguments = 0;
+  if (command == "degree" || command == "neighbours" || command == "component")
+    count_of_arguments = 1;
+  else if (command == "distance" || command == "reachable" || command == "insert" || command == "erase")
+    count_of_arguments = 2;
+  else if (command != "commit" && command != "version")
+    return "error: неизвестная команда";
+  if (!(in >> graph_number) || graph_number < 1 || graph_number > graphs.size())
+    return "error: неверный номер графа";
+  ServedGraph &served = graphs[graph_number - 1];
+  vector<size_t> vertexes(count_of_arguments);
+  for (auto &vertex : vertexes) {
+    if (!(in >> vertex))
+      return "error: не хватает номеров вершин";
+  }
+  return visit([&](const auto &graph) -> string {
+    using VertexId = typename remove_cvref_t<decltype(graph)>::VertexType;
+    for (auto &vertex : vertexes) {
+      if (vertex < 1 || vertex > graph.CountOfVertexes())
+        return "error: неверный номер вершины";
+      --vertex;
+    }
+    if (command == "insert" || command == "erase") {
+      auto &pending = session.pending[graph_number];
+      (command == "insert" ? pending.first : pending.second).emplace_back(vertexes[0], vertexes[1]);
+      return "ok";
+    }
+    if (command == "commit") {
+      {
+        lock_guard<mutex> lock(served.versions_mutex);
+        if (!served.is_versioned.load(memory_order_relaxed)) {
+          served.versions = make_unique<VersionedGraph<VertexId>>(graph);
+          served.is_versioned.store(true, memory_order_release);
         }
-        cerr << "Неверная команда, повторите попытку!" << endl;
+      }
+      auto &pending = session.pending[graph_number];
+      uint64_t number = 0;
+      get<unique_ptr<VersionedGraph<VertexId>>>(served.versions)->ApplyBatch(pending.first, pending.second, number);
+      session.pending.erase(graph_number);
+      return to_string(number);
+    }
+    if (!served.is_versioned.load(memory_order_acquire))
+      return command == "version" ? "0" : AnswerGraphQuery(graph, command, vertexes);
+    const auto &versions = *get<unique_ptr<VersionedGraph<VertexId>>>(served.versions);
+    auto snapshot = versions.Pin();
+    if (command == "version")
+      return to_string(snapshot->Number());
+    return AnswerVersionQuery(*snapshot, graph.IsOrient(), command, vertexes);
+  }, served.graph);
+}
+
+// Отвечает на запросы из стандартного ввода: на каждую непустую строку выводится одна строка ответа.
+// Работа заканчивается в конце ввода или по запросу quit.
+void ServeStream(vector<ServedGraph> &graphs) {
+  ServerSession session;
+  string request;
+  while (getline(cin, request)) {
+    if (!request.empty() && request.back() == '\r')
+      request.pop_back();
+    if (request.empty())
+      continue;
+    if (request == "quit")
+      break;
+    cout << AnswerQuery(graphs, session, request) << endl;
+  }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// Отправляет строку целиком. Возвращает false, если клиент отключился.
+bool SendAll(int client, const string &data) {
+  for (size_t sent = 0; sent < data.size();) {
+    ssize_t count = write(client, data.data() + sent, data.size() - sent);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    sent += static_cast<size_t>(count);
+  }
+  return true;
+}
+
+// Обслуживает одного клиента сокета по тому же протоколу, что и ServeStream. Ответы на все запросы,
+// пришедшие одним пакетом, отправляются вместе.
+void ServeClient(int client, vector<ServedGraph> &graphs) {
+  ServerSession session;
+  string buffer;
+  char chunk[4096];
+  bool is_open = true;
+  while (is_open) {
+    ssize_t count = read(client, chunk, sizeof(chunk));
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      break;
+    buffer.append(chunk, static_cast<size_t>(count));
+    string answers;
+    size_t begin = 0;
+    for (size_t end = buffer.find('\n'); end != string::npos; end = buffer.find('\n', begin)) {
+      string request = buffer.substr(begin, end - begin);
+      begin = end + 1;
+      if (!request.empty() && request.back() == '\r')
+        request.pop_back();
+      if (request == "quit") {
+        is_open = false;
         break;
+      }
+      if (!request.empty())
+        answers += AnswerQuery(graphs, session, request) + '\n';
     }
+    buffer.erase(0, begin);
+    if (!SendAll(client, answers))
+      break;
   }
+  close(client);
 }
 
-// Запускает основную программу и осуществляет повтор решения.
-int main() {
-  system("chcp 65001");
+// Принимает соединения на unix-сокете socket_path. Каждого клиента обслуживает свой поток,
+// поэтому запросы разных клиентов выполняются одновременно: читатели не блокируются ни друг другом,
+// ни применением изменений. Возвращает false, если сокет не удалось открыть.
+bool ServeSocket(const string &socket_path, vector<ServedGraph> &graphs) {
+  sockaddr_un address{};
+  if (socket_path.size() >= sizeof(address.sun_path))
+    return false;
+  address.sun_family = AF_UNIX;
+  copy(socket_path.begin(), socket_path.end(), address.sun_path);
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0)
+    return false;
+  unlink(socket_path.c_str());
+  if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(server, SOMAXCONN) < 0) {
+    close(server);
+    return false;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  cerr << "Запросы принимаются на сокете " << socket_path << endl;
+  mutex clients_mutex;
+  condition_variable clients_finished;
+  size_t count_of_clients = 0;
+  while (true) {
+    int client = accept(server, nullptr, nullptr);
+    if (client < 0 && errno == EINTR)
+      continue;
+    if (client < 0)
+      break;
+    lock_guard<mutex> lock(clients_mutex);
+    ++count_of_clients;
+    thread([&, client]() {
+      ServeClient(client, graphs);
+      lock_guard<mutex> client_lock(clients_mutex);
+      --count_of_clients;
+      clients_finished.notify_all();
+    }).detach();
+  }
+  close(server);
+  unique_lock<mutex> lock(clients_mutex);
+  clients_finished.wait(lock, [&]() { return count_of_clients == 0; });
+  return true;
+}
+#else
+// Unix-сокеты недоступны на этой платформе.
+bool ServeSocket(const string &, vector<ServedGraph> &) {
+  cerr << "Сокеты не поддерживаются на этой платформе!" << endl;
+  return false;
+}
+#endif
+
+// Режим сервера: загруженные графы остаются в памяти, а запросы к ним принимаются
+// на unix-сокете socket_path или, если путь пуст, из стандартного ввода.
+int RunServer(vector<AnyGraph> &graphs, const string &socket_path) {
+  vector<ServedGraph> served(graphs.size());
+  for (size_t i = 0; i < graphs.size(); ++i) {
+    served[i].graph = move(graphs[i]);
+    visit([](auto &typed_graph) { typed_graph.PrepareQueries(); }, served[i].graph);
+  }
+  cerr << "Загружено графов: " << served.size() << endl;
+  if (socket_path.empty()) {
+    ServeStream(served);
+    return 0;
+  }
+  if (!ServeSocket(socket_path, served)) {
+    cerr << "Ошибка открытия сокета " << socket_path << "!" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Число ребер потока, которые применяются к графу одной пачкой.
+const size_t kStreamBatch = 4096;
+
+// Показатели графа, читаемого из потока ребер. Их обновляет поток чтения после каждой пачки,
+// а поток статистики читает, не останавливая чтение.
+struct StreamStatistics {
+  atomic<size_t> count_of_vertexes = 0;
+  atomic<size_t> count_of_edges = 0;
+  atomic<size_t> count_of_components = 0;
+  atomic<size_t> max_degree = 0;
+  atomic<size_t> count_of_skipped_lines = 0;
+};
+
+// Выводит строку статистики потока ребер.
+void PrintStreamStatistics(const StreamStatistics &statistics) {
+  cout << "Вершин: " << statistics.count_of_vertexes.load(memory_order_relaxed)
+       << ", ребер: " << statistics.count_of_edges.load(memory_order_relaxed)
+       << ", компонент связности: " << statistics.count_of_components.load(memory_order_relaxed)
+       << ", максимальная степень: " << statistics.max_degree.load(memory_order_relaxed);
+  size_t count_of_skipped_lines = statistics.count_of_skipped_lines.load(memory_order_relaxed);
+  if (count_of_skipped_lines != 0)
+    cout << ", пропущено строк: " << count_of_skipped_lines;
+  cout << endl;
+}
+
+// Граф, который растет по мере чтения потока ребер. Вершины появляются, когда встречаются в ребрах;
+// степени и компоненты связности (в ориентированном графе - слабой) обновляются с каждой пачкой.
+class StreamingGraph {
+ private:
+  bool is_orient_;
+  bool is_weighted_ = false;
+  vector<Arc> arcs_;
+  vector<Weight> arc_weights_;
+  vector<size_t> degrees_;
+  // Уже прочитанные ребра: для каждой вершины - номер первой дуги в arcs_ по второму концу ребра.
+  // В неориентированном графе ребро хранится у меньшего конца.
+  vector<unordered_map<size_t, size_t>> edge_arcs_;
+  DisjointSets components_{0};
+  size_t count_of_edges_ = 0;
+  size_t count_of_components_ = 0;
+  size_t max_degree_ = 0;
+
+ public:
+  explicit StreamingGraph(bool is_orient) : is_orient_(is_orient) {}
+
+  // Добавляет пачку ребер (нумерация вершин с 0) и их весов. Повторное ребро не меняет
+  // показателей графа; как и при построении графа, у него остается наименьший вес.
+  void AddBatch(const vector<Arc> &edges, const vector<Weight> &weights, bool is_weighted) {
+    is_weighted_ = is_weighted_ || is_weighted;
+    for (size_t i = 0; i < edges.size(); ++i) {
+      auto [from, to] = edges[i];
+      size_t count_of_vertexes = max(max(from, to) + 1, degrees_.size());
+      count_of_components_ += count_of_vertexes - degrees_.size();
+      degrees_.resize(count_of_vertexes, 0);
+      edge_arcs_.resize(count_of_vertexes);
+      components_.Grow(count_of_vertexes);
+      size_t owner = is_orient_ ? from : min(from, to);
+      auto [seen, is_new] = edge_arcs_[owner].try_emplace(owner == from ? to : from, arcs_.size());
+      if (!is_new) {
+        size_t arc = seen->second;
+        arc_weights_[arc] = min(arc_weights_[arc], weights[i]);
+        if (!is_orient_)
+          arc_weights_[arc + 1] = arc_weights_[arc];
+        continue;
+      }
+      max_degree_ = max(max_degree_, ++degrees_[from]);
+      max_degree_ = max(max_degree_, ++degrees_[to]);
+      if (components_.Unite(from, to))
+        --count_of_components_;
+      arcs_.emplace_back(from, to);
+      arc_weights_.push_back(weights[i]);
+      if (!is_orient_) {
+        arcs_.emplace_back(to, from);
+        arc_weights_.push_back(weights[i]);
+      }
+      ++count_of_edges_;
+    }
+  }
+
+  // Записывает текущие показатели для потока статистики.
+  void Publish(StreamStatistics &statistics) const {
+    statistics.count_of_vertexes.store(degrees_.size(), memory_order_relaxed);
+    statistics.count_of_edges.store(count_of_edges_, memory_order_relaxed);
+    statistics.count_of_components.store(count_of_components_, memory_order_relaxed);
+    statistics.max_degree.store(max_degree_, memory_order_relaxed);
+  }
+
+  // Строит из накопленных ребер обычный граф.
+  AnyGraph Build() const {
+    return MakeGraph(degrees_.size(), count_of_edges_, arcs_, is_weighted_ ? arc_weights_ : vector<Weight>(), is_orient_);
+  }
+};
+
+// Разбирает строку потока ребер "откуда куда [вес]" (вершины нумеруются с 1).
+// Возвращает false, если строка не описывает ребро; петли тоже считаются некорректными.
+bool ParseStreamEdge(const string &line, Arc &edge, Weight &weight, bool &has_weight) {
+  const char *position = line.data();
+  const char *end = position + line.size();
+  auto read_number = [&](auto &value) {
+    while (position != end && (*position == ' ' || *position == '\t'))
+      ++position;
+    auto [next, error] = from_chars(position, end, value);
+    if (error != errc())
+      return false;
+    position = next;
+    return true;
+  };
+  if (!read_number(edge.first) || !read_number(edge.second) || edge.first == 0 || edge.second == 0
+      || edge.first == edge.second)
+    return false;
+  --edge.first;
+  --edge.second;
+  weight = 1;
+  has_weight = read_number(weight);
+  return true;
+}
+
+// Читает поток ребер до конца ввода и раз в interval выводит статистику из отдельного потока.
+// Ребра применяются пачками: пачка закрывается, когда набралось kStreamBatch ребер или когда
+// новых данных во входном буфере пока нет, чтобы статистика медленного источника не отставала.
+StreamingGraph IngestEdgeStream(istream &in, bool is_orient, chrono::milliseconds interval) {
+  StreamingGraph graph(is_orient);
+  StreamStatistics statistics;
+  // Привязанный к вводу cout сбрасывался бы при каждом чтении, а в него пишет поток статистики.
+  ostream *tied_stream = in.tie(nullptr);
+  mutex stop_mutex;
+  condition_variable stop_condition;
+  bool is_stopped = false;
+  thread reporter([&] {
+    unique_lock<mutex> lock(stop_mutex);
+    while (!stop_condition.wait_for(lock, interval, [&] { return is_stopped; })) {
+      PrintStreamStatistics(statistics);
+    }
+  });
+  vector<Arc> edges;
+  vector<Weight> weights;
+  edges.reserve(kStreamBatch);
+  weights.reserve(kStreamBatch);
+  bool is_weighted = false;
+  size_t count_of_skipped_lines = 0;
+  auto apply_batch = [&] {
+    graph.AddBatch(edges, weights, is_weighted);
+    graph.Publish(statistics);
+    statistics.count_of_skipped_lines.store(count_of_skipped_lines, memory_order_relaxed);
+    edges.clear();
+    weights.clear();
+    is_weighted = false;
+  };
+  string line;
+  while (getline(in, line)) {
+    Arc edge;
+    Weight weight;
+    bool has_weight;
+    if (ParseStreamEdge(line, edge, weight, has_weight)) {
+      edges.push_back(edge);
+      weights.push_back(weight);
+      is_weighted = is_weighted || has_weight;
+    } else if (line.find_first_not_of(" \t\r") != string::npos) {
+      ++count_of_skipped_lines;
+    }
+    if (edges.size() >= kStreamBatch || in.rdbuf()->in_avail() <= 0)
+      apply_batch();
+  }
+  apply_batch();
+  {
+    lock_guard<mutex> lock(stop_mutex);
+    is_stopped = true;
+  }
+  stop_condition.notify_one();
+  reporter.join();
+  in.tie(tied_stream);
+  PrintStreamStatistics(statistics);
+  return graph;
+}
+
+// Запускает основную программу и осуществляет повтор решения. Режимы командной строки:
+// --server [--socket путь] [--attach имя | файл графа ...] - сервер запросов к графам;
+// --publish имя [файл графа] - опубликовать граф в разделяемой памяти (имя /name) или в файле;
+// --unpublish имя - удалить опубликованный граф;
+// --attach имя - работать через меню с опубликованным графом;
+// --stream [--orient] [--interval секунды] [файл или FIFO] - читать поток ребер со статистикой.
+int main(int argc, char *argv[]) {
   string output_path;
   string input_path;
   output_path = "..";
@@ -665,10 +5183,95 @@ int main() {
   input_path = "..";
   input_path += filesystem::path::preferred_separator;
   input_path += "input.txt";
+  string mode = argc > 1 ? argv[1] : "";
+  if (mode == "--server") {
+    string socket_path;
+    vector<AnyGraph> graphs;
+    for (int i = 2; i < argc; ++i) {
+      string argument = argv[i];
+      if (argument == "--socket" && i + 1 < argc) {
+        socket_path = argv[++i];
+        continue;
+      }
+      graphs.emplace_back();
+      if (argument == "--attach" && i + 1 < argc) {
+        if (!AttachGraph(argv[++i], graphs.back())) {
+          cerr << "Ошибка подключения графа " << argv[i] << "!" << endl;
+          return 1;
+        }
+      } else if (!LoadGraphFile(argument, graphs.back())) {
+        return 1;
+      }
+    }
+    if (graphs.empty()) {
+      graphs.emplace_back();
+      if (!LoadGraphFile(input_path, graphs.back()))
+        return 1;
+    }
+    return RunServer(graphs, socket_path);
+  }
+  if (mode == "--publish" && argc > 2) {
+    AnyGraph graph;
+    if (!LoadGraphFile(argc > 3 ? argv[3] : input_path, graph))
+      return 1;
+    if (!PublishGraph(graph, argv[2])) {
+      cerr << "Ошибка публикации графа " << argv[2] << "!" << endl;
+      return 1;
+    }
+    cerr << "Граф опубликован: " << argv[2] << endl;
+    return 0;
+  }
+  if (mode == "--unpublish" && argc > 2) {
+    if (!RemovePublishedGraph(argv[2])) {
+      cerr << "Ошибка удаления графа " << argv[2] << "!" << endl;
+      return 1;
+    }
+    return 0;
+  }
+  if (mode == "--attach" && argc > 2) {
+    AnyGraph graph;
+    if (!AttachGraph(argv[2], graph)) {
+      cerr << "Ошибка подключения графа " << argv[2] << "!" << endl;
+      return 1;
+    }
+    system("chcp 65001");
+    visit([](auto &typed_graph) { Program(typed_graph); }, graph);
+    return 0;
+  }
+  if (mode == "--stream") {
+    bool is_orient = false;
+    double interval = 1;
+    string stream_path;
+    for (int i = 2; i < argc; ++i) {
+      string argument = argv[i];
+      if (argument == "--orient")
+        is_orient = true;
+      else if (argument == "--interval" && i + 1 < argc)
+        interval = atof(argv[++i]);
+      else
+        stream_path = argument;
+    }
+    auto period = chrono::milliseconds(max<long long>(1, llround(interval * 1000)));
+    ios::sync_with_stdio(false);
+    if (stream_path.empty()) {
+      IngestEdgeStream(cin, is_orient, period);
+      return 0;
+    }
+    ifstream fin(stream_path);
+    if (!fin.is_open()) {
+      cerr << "Ошибка чтения файла " << stream_path << "!" << endl;
+      return 1;
+    }
+    AnyGraph graph = IngestEdgeStream(fin, is_orient, period).Build();
+    system("chcp 65001");
+    visit([](auto &typed_graph) { Program(typed_graph); }, graph);
+    return 0;
+  }
+  system("chcp 65001");
   while (true) {
-    Graph graph;
+    AnyGraph graph;
     if (ReadGraph(graph, input_path)) {
-      Program(graph);
+      visit([](auto &typed_graph) { Program(typed_graph); }, graph);
     }
     cout << "Для выхода из программы введите 0, иначе любое другое число" << endl << "> ";
     string key;
@@ -676,4 +5279,4 @@ int main() {
     if (key[0] == '0')
       break;
   }
-}
\ No newline at end of file
+}